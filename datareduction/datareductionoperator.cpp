@@ -366,25 +366,26 @@ namespace DRO {
          Real thread_nvyvy_sum = 0.0;
          Real thread_nvzvz_sum = 0.0;
          
-         const Real* parameters  = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
          
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {
+            cell->get_block_info(n,popID,parameters);
 	    for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
 	       const Real VX 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-		 + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
+		 =          parameters[BlockParams::VXCRD] 
+		 + (i + HALF)*parameters[BlockParams::DVX];
 	       const Real VY 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-		 + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
+		 =          parameters[BlockParams::VYCRD] 
+		 + (j + HALF)*parameters[BlockParams::DVY];
 	       const Real VZ 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-		 + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+		 =          parameters[BlockParams::VZCRD] 
+		 + (k + HALF)*parameters[BlockParams::DVZ];
 	       const Real DV3 
-		 = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-		 * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-		 * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+		 = parameters[BlockParams::DVX]
+		 * parameters[BlockParams::DVY] 
+		 * parameters[BlockParams::DVZ];
                      
 	       thread_nvxvx_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
 	       thread_nvyvy_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
@@ -440,25 +441,26 @@ namespace DRO {
          Real thread_nvzvx_sum = 0.0;
          Real thread_nvyvz_sum = 0.0;
          
-         const Real* parameters = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
          
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {               
+            cell->get_block_info(n,popID,parameters);
 	    for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
 	       const Real VX 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-		 + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
+		 =          parameters[BlockParams::VXCRD] 
+		 + (i + HALF)*parameters[BlockParams::DVX];
 	       const Real VY 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-		 + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
+		 =          parameters[BlockParams::VYCRD] 
+		 + (j + HALF)*parameters[BlockParams::DVY];
 	       const Real VZ 
-		 =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-		 + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+		 =          parameters[BlockParams::VZCRD] 
+		 + (k + HALF)*parameters[BlockParams::DVZ];
 	       const Real DV3 
-		 = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-		 * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-		 * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+		 = parameters[BlockParams::DVX]
+		 * parameters[BlockParams::DVY] 
+		 * parameters[BlockParams::DVZ];
 	       
 	       thread_nvxvy_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VX - averageVX) * (VY - averageVY) * DV3;
 	       thread_nvzvx_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VZ - averageVZ) * (VX - averageVX) * DV3;
@@ -722,21 +724,22 @@ namespace DRO {
       {
          Real thread_n_sum = 0.0;
          
-         const Real* parameters = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
          
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            cell->get_block_info(n,popID,parameters);
             const Real DV3
-            = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+            = parameters[BlockParams::DVX]
+            * parameters[BlockParams::DVY]
+            * parameters[BlockParams::DVZ];
             vector< uint64_t > vCells; //Velocity cell ids
             vCells.clear();
             if ( calculateNonthermal == true ) {
-               getNonthermalVelocityCells(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCells, popID);
+               getNonthermalVelocityCells(parameters, vCells, popID);
             } else {
-               getThermalVelocityCells(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCells, popID);
+               getThermalVelocityCells(parameters, vCells, popID);
             }
             for( vector< uint64_t >::const_iterator it = vCells.begin(); it != vCells.end(); ++it ) {
                //velocity cell id = *it
@@ -769,24 +772,25 @@ namespace DRO {
          Real thread_nvz_sum = 0.0;
          Real thread_n_sum = 0.0;
 
-         const Real* parameters = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
          
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            cell->get_block_info(n,popID,parameters);
             // Get the volume of a velocity cell
             const Real DV3
-            = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+            = parameters[BlockParams::DVX]
+            * parameters[BlockParams::DVY]
+            * parameters[BlockParams::DVZ];
             // Get the velocity cell indices of the cells that are a part of the nonthermal population
             vector< array<uint, 3> > vCellIndices;
             vCellIndices.clear();
             // Save indices to the std::vector
             if( calculateNonthermal == true ) {
-               getNonthermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getNonthermalVelocityCellIndices(parameters, vCellIndices, popID);
             } else {
-               getThermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getThermalVelocityCellIndices(parameters, vCellIndices, popID);
             }
             // We have now fetched all of the needed velocity cell indices, so now go through them:
             for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
@@ -796,9 +800,9 @@ namespace DRO {
                const uint j = indices[1];
                const uint k = indices[2];
                // Get the coordinates of the velocity cell (e.g. VX = block_vx_min_coordinates + (velocity_cell_indice_x+0.5)*length_of_velocity_cell_in_x_direction)
-               const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-               const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-               const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+               const Real VX = parameters[BlockParams::VXCRD] + (i + HALF) * parameters[BlockParams::DVX];
+               const Real VY = parameters[BlockParams::VYCRD] + (j + HALF) * parameters[BlockParams::DVY];
+               const Real VZ = parameters[BlockParams::VZCRD] + (k + HALF) * parameters[BlockParams::DVZ];
                // Add the value of the coordinates and multiply by the AVGS value of the velocity cell and the volume of the velocity cell
                thread_nvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]*VX*DV3;
                thread_nvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]*VY*DV3;
@@ -840,21 +844,22 @@ namespace DRO {
          Real thread_nvyvy_sum = 0.0;
          Real thread_nvzvz_sum = 0.0;
          
-         const Real* parameters = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
       
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            cell->get_block_info(n,popID,parameters);
             const Real DV3
-            = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+            = parameters[BlockParams::DVX]
+            * parameters[BlockParams::DVY]
+            * parameters[BlockParams::DVZ];
             vector< array<uint, 3> > vCellIndices;
             vCellIndices.clear();
             if( calculateNonthermal == true ) {
-               getNonthermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getNonthermalVelocityCellIndices(parameters, vCellIndices, popID);
             } else {
-               getThermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getThermalVelocityCellIndices(parameters, vCellIndices, popID);
             }
             for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
                //Go through every velocity cell:
@@ -862,9 +867,9 @@ namespace DRO {
                const uint i = indices[0];
                const uint j = indices[1];
                const uint k = indices[2];
-               const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-               const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-               const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+               const Real VX = parameters[BlockParams::VXCRD] + (i + HALF) * parameters[BlockParams::DVX];
+               const Real VY = parameters[BlockParams::VYCRD] + (j + HALF) * parameters[BlockParams::DVY];
+               const Real VZ = parameters[BlockParams::VZCRD] + (k + HALF) * parameters[BlockParams::DVZ];
                thread_nvxvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
                thread_nvyvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
                thread_nvzvz_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VZ - averageVZ) * (VZ - averageVZ) * DV3;
@@ -901,20 +906,21 @@ namespace DRO {
          Real thread_nvzvx_sum = 0.0;
          Real thread_nvyvz_sum = 0.0;
          
-         const Real* parameters = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
       
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            cell->get_block_info(n,popID,parameters);
             const Real DV3
-            = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-            * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+            = parameters[BlockParams::DVX]
+            * parameters[BlockParams::DVY]
+            * parameters[BlockParams::DVZ];
             vector< array<uint, 3> > vCellIndices;
             if( calculateNonthermal == true ) {
-               getNonthermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getNonthermalVelocityCellIndices(parameters, vCellIndices, popID);
             } else {
-               getThermalVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices, popID);
+               getThermalVelocityCellIndices(parameters, vCellIndices, popID);
             }
             for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
                //Go through every velocity cell:
@@ -922,9 +928,9 @@ namespace DRO {
                const uint i = indices[0];
                const uint j = indices[1];
                const uint k = indices[2];
-               const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-               const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-               const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+               const Real VX = parameters[BlockParams::VXCRD] + (i + HALF) * parameters[BlockParams::DVX];
+               const Real VY = parameters[BlockParams::VYCRD] + (j + HALF) * parameters[BlockParams::DVY];
+               const Real VZ = parameters[BlockParams::VZCRD] + (k + HALF) * parameters[BlockParams::DVZ];
                thread_nvxvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VX - averageVX) * (VY - averageVY) * DV3;
                thread_nvzvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VZ - averageVZ) * (VX - averageVX) * DV3;
                thread_nvyvz_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VY - averageVY) * (VZ - averageVZ) * DV3;
@@ -1384,26 +1390,27 @@ namespace DRO {
          std::vector<Real> thread_lossCone_sum(nChannels,0.0);
          std::vector<Real> thread_count(nChannels,0.0);
          
-         const Real* parameters  = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
          
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {
+            cell->get_block_info(n,popID,parameters);
             for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
                const Real VX 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-                  + (i + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
+                  =          parameters[BlockParams::VXCRD] 
+                  + (i + 0.5)*parameters[BlockParams::DVX];
                const Real VY 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-                  + (j + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
+                  =          parameters[BlockParams::VYCRD] 
+                  + (j + 0.5)*parameters[BlockParams::DVY];
                const Real VZ 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-                  + (k + 0.5)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+                  =          parameters[BlockParams::VZCRD] 
+                  + (k + 0.5)*parameters[BlockParams::DVZ];
 
                const Real DV3 
-                  = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-                  * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-                  * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+                  = parameters[BlockParams::DVX]
+                  * parameters[BlockParams::DVY] 
+                  * parameters[BlockParams::DVZ];
 
                const Real normV = sqrt(VX*VX + VY*VY + VZ*VZ);
                const Real VdotB_norm = (B[0]*VX + B[1]*VY + B[2]*VZ)/normV;
@@ -1502,26 +1509,27 @@ namespace DRO {
          Real thread_E1_sum = 0.0;
          Real thread_E2_sum = 0.0;
          
-         const Real* parameters  = cell->get_block_parameters(popID);
+         Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Realf* block_data = cell->get_data(popID);
         
          # pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {
+            cell->get_block_info(n,popID,parameters);
             const Real DV3 
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+               = parameters[BlockParams::DVX]
+               * parameters[BlockParams::DVY] 
+               * parameters[BlockParams::DVZ];
 
             for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
                const Real VX 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-                  + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
+                  =          parameters[BlockParams::VXCRD] 
+                  + (i + HALF)*parameters[BlockParams::DVX];
                const Real VY 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-                  + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
+                  =          parameters[BlockParams::VYCRD] 
+                  + (j + HALF)*parameters[BlockParams::DVY];
                const Real VZ 
-                  =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-                  + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+                  =          parameters[BlockParams::VZCRD] 
+                  + (k + HALF)*parameters[BlockParams::DVZ];
                      
                const Real ENERGY = (VX*VX + VY*VY + VZ*VZ) * HALF * getObjectWrapper().particleSpecies[popID].mass;
                thread_E0_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * ENERGY * DV3;
@@ -24,6 +24,7 @@
 
 #include "fs_common.h"
 #include "derivatives.hpp"
+#include "ldz_gradpe.hpp"
 #include "fs_limiters.h"
 
 /*! \brief Low-level spatial derivatives calculation.
@@ -282,8 +283,10 @@ void calculateDerivatives(
  * \param sysBoundaries System boundary conditions existing
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  * \param communicateMoments If true, the derivatives of moments (rho, V, P) are communicated to neighbours.
+ * \param EGradPeGrid fsGrid holding the electron pressure gradient E field
+ * \param computeGradPe If true, the electron pressure gradient term is computed in the same pass, as it only needs the derivatives of the cell itself. The derivatives of moments are then communicated afterwards.
  
- * \sa calculateDerivatives calculateBVOLDerivativesSimple calculateBVOLDerivatives
+ * \sa calculateDerivatives calculateBVOLDerivativesSimple calculateBVOLDerivatives calculateGradPeTerm
  */
 void calculateDerivativesSimple(
    FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
@@ -295,7 +298,9 @@ void calculateDerivativesSimple(
    FsGrid< fsgrids::technical, 2> & technicalGrid,
    SysBoundary& sysBoundaries,
    cint& RKCase,
-   const bool communicateMoments) {
+   const bool communicateMoments,
+   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
+   const bool computeGradPe) {
    int timer;
    //const std::array<int, 3> gridDims = technicalGrid.getLocalSize();
    const int* gridDims = &technicalGrid.getLocalSize()[0];
@@ -303,58 +308,87 @@ void calculateDerivativesSimple(
    
    phiprof::start("Calculate face derivatives");
    
-   timer=phiprof::initializeTimer("MPI","MPI");
-   phiprof::start(timer);
-   
-   switch (RKCase) {
-    case RK_ORDER1:
-      // Means initialising the solver as well as RK_ORDER1
-      // standard case Exchange PERB* with neighbours
-      // The update of PERB[XYZ] is needed after the system
-      // boundary update of propagateMagneticFieldSimple.
-       perBGrid.updateGhostCells();
-       if(communicateMoments) {
-         momentsGrid.updateGhostCells();
-       }
-       break;
-    case RK_ORDER2_STEP1:
-      // Exchange PERB*_DT2,RHO_DT2,V*_DT2 with neighbours The
-      // update of PERB[XYZ]_DT2 is needed after the system
-      // boundary update of propagateMagneticFieldSimple.
-       perBDt2Grid.updateGhostCells();
-       if(communicateMoments) {
-         momentsDt2Grid.updateGhostCells();
-       }
-       break;
-    case RK_ORDER2_STEP2:
-      // Exchange PERB*,RHO,V* with neighbours The update of B
-      // is needed after the system boundary update of
-      // propagateMagneticFieldSimple.
-       perBGrid.updateGhostCells();
-       if(communicateMoments) {
-         momentsGrid.updateGhostCells();
-       }
-      break;
-    default:
-      cerr << __FILE__ << ":" << __LINE__ << " Went through switch, this should not happen." << endl;
-      abort();
-   }
-   
-   phiprof::stop(timer);
-
+   const int mpiTimer=phiprof::initializeTimer("MPI","MPI");
    timer=phiprof::initializeTimer("Compute cells");
    phiprof::start(timer);
-
+   
    // Calculate derivatives
-   #pragma omp parallel for collapse(3)
-   for (int k=0; k<gridDims[2]; k++) {
-      for (int j=0; j<gridDims[1]; j++) {
-         for (int i=0; i<gridDims[0]; i++) {
-            if (technicalGrid.get(i,j,k)->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
-            if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
-               calculateDerivatives(i,j,k, perBGrid, momentsGrid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RKCase);
+   auto computeCells = [&](cint iStart, cint iEnd, cint j, cint k) {
+      for (int i=iStart; i<iEnd; i++) {
+         if (technicalGrid.get(i,j,k)->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
+         if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
+            calculateDerivatives(i,j,k, perBGrid, momentsGrid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RKCase);
+            if (computeGradPe) {
+               calculateGradPeTerm(EGradPeGrid, momentsGrid, dMomentsGrid, technicalGrid, i, j, k, sysBoundaries);
+            }
+         } else {
+            calculateDerivatives(i,j,k, perBDt2Grid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RKCase);
+            if (computeGradPe) {
+               calculateGradPeTerm(EGradPeGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, i, j, k, sysBoundaries);
+            }
+         }
+      }
+   };
+   
+   const InnerCells inner(technicalGrid);
+   #pragma omp parallel
+   {
+      // The master thread updates the ghost cells while the other threads start on the inner cells
+      #pragma omp master
+      {
+         phiprof::start(mpiTimer);
+         switch (RKCase) {
+          case RK_ORDER1:
+            // Means initialising the solver as well as RK_ORDER1
+            // standard case Exchange PERB* with neighbours
+            // The update of PERB[XYZ] is needed after the system
+            // boundary update of propagateMagneticFieldSimple.
+             perBGrid.updateGhostCells();
+             if(communicateMoments) {
+               momentsGrid.updateGhostCells();
+             }
+             break;
+          case RK_ORDER2_STEP1:
+            // Exchange PERB*_DT2,RHO_DT2,V*_DT2 with neighbours The
+            // update of PERB[XYZ]_DT2 is needed after the system
+            // boundary update of propagateMagneticFieldSimple.
+             perBDt2Grid.updateGhostCells();
+             if(communicateMoments) {
+               momentsDt2Grid.updateGhostCells();
+             }
+             break;
+          case RK_ORDER2_STEP2:
+            // Exchange PERB*,RHO,V* with neighbours The update of B
+            // is needed after the system boundary update of
+            // propagateMagneticFieldSimple.
+             perBGrid.updateGhostCells();
+             if(communicateMoments) {
+               momentsGrid.updateGhostCells();
+             }
+            break;
+          default:
+            cerr << __FILE__ << ":" << __LINE__ << " Went through switch, this should not happen." << endl;
+            abort();
+         }
+         phiprof::stop(mpiTimer);
+      }
+      
+      #pragma omp for collapse(2) schedule(dynamic,1)
+      for (int k=inner.start[2]; k<inner.end[2]; k++) {
+         for (int j=inner.start[1]; j<inner.end[1]; j++) {
+            computeCells(inner.start[0], inner.end[0], j, k);
+         }
+      }
+      
+      // The boundary shell, the ghost cells are up to date after the barrier ending the previous loop
+      #pragma omp for collapse(2)
+      for (int k=0; k<gridDims[2]; k++) {
+         for (int j=0; j<gridDims[1]; j++) {
+            if (inner.isInnerRow(j,k)) {
+               computeCells(0, inner.start[0], j, k);
+               computeCells(inner.end[0], gridDims[0], j, k);
             } else {
-               calculateDerivatives(i,j,k, perBDt2Grid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RKCase);
+               computeCells(0, gridDims[0], j, k);
             }
          }
       }
@@ -362,6 +396,14 @@ void calculateDerivativesSimple(
 
    phiprof::stop(timer,N_cells,"Spatial Cells");
    
+   if (computeGradPe) {
+      // Done here instead of in the Hall term, see hallTermCommunicateDerivatives in propagateFields
+      timer=phiprof::initializeTimer("MPI","MPI");
+      phiprof::start(timer);
+      dMomentsGrid.updateGhostCells();
+      phiprof::stop(timer);
+   }
+   
    phiprof::stop("Calculate face derivatives",N_cells,"Spatial Cells");   
 }
 
@@ -37,7 +37,9 @@ void calculateDerivativesSimple(
    FsGrid< fsgrids::technical, 2> & technicalGrid,
    SysBoundary& sysBoundaries,
    cint& RKCase,
-   const bool communicateMoments);
+   const bool communicateMoments,
+   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
+   const bool computeGradPe);
 
 
 void calculateBVOLDerivativesSimple(
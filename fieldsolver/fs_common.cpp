@@ -22,24 +22,6 @@
 
 #include "fs_common.h"
 
-/*! \brief Helper function
- * 
- * Divides the first value by the second or returns zero if the denominator is zero.
- * 
- * \param numerator Numerator
- * \param denominator Denominator
- */
-Real divideIfNonZero(
-   creal numerator,
-   creal denominator
-) {
-   if(denominator <= 0.0) {
-      return 0.0;
-   } else {
-      return numerator / denominator;
-   }
-}
-
 /*! \brief Low-level helper function.
  * 
  * Computes the reconstruction coefficients used for field component reconstruction.
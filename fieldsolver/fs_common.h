@@ -101,7 +101,56 @@ bool propagateFields(
    cuint subcycles
 );
 
-Real divideIfNonZero(creal rhoV, creal rho);
+/*! \brief Helper function
+ * 
+ * Divides the first value by the second or returns zero if the denominator is zero.
+ * 
+ * \param numerator Numerator
+ * \param denominator Denominator
+ *
+ * Inline, as it is called for every cell in the field solver loops.
+ */
+inline Real divideIfNonZero(
+   creal numerator,
+   creal denominator
+) {
+   if(denominator <= 0.0) {
+      return 0.0;
+   } else {
+      return numerator / denominator;
+   }
+}
+
+/*! \brief Box of local cells whose stencil, reaching one cell in each direction, does not touch the ghost cells.
+ *
+ * The inner cells can be computed while the ghost cells are being updated, the rest of the local cells form
+ * the boundary shell which has to wait for the update. Dimensions with a single cell in the whole simulation
+ * have no ghost cells, so all cells are inner in them.
+ */
+struct InnerCells {
+   std::array<int, 3> start; /*!< First inner cell in each dimension */
+   std::array<int, 3> end;   /*!< One past the last inner cell in each dimension */
+
+   /*! \param technicalGrid fsGrid holding technical information, any fsGrid of the simulation would do */
+   InnerCells(FsGrid< fsgrids::technical, 2> & technicalGrid) {
+      const std::array<int32_t, 3> localDims = technicalGrid.getLocalSize();
+      const std::array<int32_t, 3> globalDims = technicalGrid.getGlobalSize();
+      for (int d=0; d<3; d++) {
+         if (globalDims[d] > 1) {
+            start[d] = min(1, localDims[d]);
+            end[d] = max(start[d], localDims[d]-1);
+         } else {
+            start[d] = 0;
+            end[d] = localDims[d];
+         }
+      }
+   }
+
+   /*! Whether the row of cells (*,j,k) goes through the box of inner cells */
+   bool isInnerRow(cint j, cint k) const {
+      return j >= start[1] && j < end[1] && k >= start[2] && k < end[2];
+   }
+};
 
 /*! Namespace encompassing the enum defining the list of reconstruction coefficients used in field component reconstructions.*/
 namespace Rec {
@@ -6,6 +6,8 @@
 #include "../common.h"
 #include "gridGlue.hpp"
 
+#include <unordered_map>
+
 /*
 Calculate the number of cells on the maximum refinement level overlapping the list of dccrg cells in cells.
 */
@@ -85,99 +87,251 @@ template <typename T, int stencil> void computeCoupling(dccrg::Dccrg<SpatialCell
   }
 }
 
-void feedMomentsIntoFsGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                           const std::vector<CellID>& cells,
-                           FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2>& momentsGrid, bool dt2 /*=false*/) {
+/* Field sums sent from fsgrid to dccrg, averaged over the fsgrid cells of each dccrg cell
+   that are not DO_NOT_COMPUTE.
+*/
+const int fieldsToCommunicate = 21;
+struct Average {
+  Real sums[fieldsToCommunicate];
+  int cells;
+  Average()  {
+    cells = 0;
+    for(int i = 0; i < fieldsToCommunicate; i++){
+       sums[i] = 0;
+    }
+  }
+  Average operator+=(const Average& rhs) {
+    this->cells += rhs.cells;
+    for(int i = 0; i < fieldsToCommunicate; i++){
+       this->sums[i] += rhs.sums[i];
+    }
+  return *this;
+  }
+};
+
+/* Cached coupling DCCRG <=> FSGRID. The sets and maps of computeCoupling are flattened
+   into arrays with offsets per remote process, and the communication buffers are
+   kept between calls. All FsGrids have the same decomposition, so one plan serves
+   every coupling call. The plan is keyed on the repartition count
+   (Parameters::meshRepartitionCount) and the list of local cells it was built for,
+   so it is rebuilt once after each repartition, or if called with other cells.
+
+   dccrgProcesses            fsgrid processes to which local dccrg cells map
+   dccrgCells                local dccrg cells that map to dccrgProcesses[p], sorted, in the range
+                             dccrgProcessStart[p] .. dccrgProcessStart[p+1]
+   dccrgCellIndices          index of each dccrgCells entry in the list of local cells
+   fsgridProcesses           dccrg processes owning cells that map to local fsgrid cells
+   fsgridCells               remote dccrg cells owned by fsgridProcesses[p], sorted, in the range
+                             fsgridProcessStart[p] .. fsgridProcessStart[p+1]
+   fsgridLocalIDs            local fsgrid cells of each fsgridCells entry c, in the range
+                             fsgridCellStart[c] .. fsgridCellStart[c+1]
+
+   The buffers only move when the plan is rebuilt, so all transfers are persistent
+   MPI requests created together with the plan. A coupling call only packs the
+   buffers and does MPI_Startall and MPI_Waitall.
+*/
+struct CouplingPlan {
+  bool valid;
+  uint repartitionCount;
+  std::vector<CellID> cells;
+  std::vector<int> dccrgProcesses;
+  std::vector<size_t> dccrgProcessStart;
+  std::vector<CellID> dccrgCells;
+  std::vector<size_t> dccrgCellIndices;
+  std::vector<int> fsgridProcesses;
+  std::vector<size_t> fsgridProcessStart;
+  std::vector<CellID> fsgridCells;
+  std::vector<size_t> fsgridCellStart;
+  std::vector<int64_t> fsgridLocalIDs;
+
+  // Communication buffers and persistent requests, created when the plan is built
+  std::vector<Real> dccrgMoments;
+  std::vector<Real> fsgridMoments;
+  std::vector<Average> dccrgFields;
+  std::vector<Average> fsgridFields;
+  std::vector<Average> aggregatedFields;
+  std::vector<MPI_Request> momentSendRequests;
+  std::vector<MPI_Request> momentReceiveRequests;
+  std::vector<MPI_Request> fieldSendRequests;
+  std::vector<MPI_Request> fieldReceiveRequests;
+
+  CouplingPlan(): valid(false), repartitionCount(0) { }
+};
+
+static CouplingPlan couplingPlan;
+
+/* Free the persistent requests in requests, they are inactive between coupling calls.
+*/
+static void freeCouplingRequests(std::vector<MPI_Request>& requests) {
+  for (auto& request : requests) {
+    if (request != MPI_REQUEST_NULL) {
+      MPI_Request_free(&request);
+    }
+  }
+  requests.clear();
+}
 
-  int ii;
-  //sorted list of dccrg cells. cells is typicall already sorted, but just to make sure....
-  std::vector<CellID> dccrgCells = cells;
-  std::sort(dccrgCells.begin(), dccrgCells.end());
+/* Release the persistent requests and buffers of the coupling plan. Must be called
+   before MPI_Finalize.
+*/
+void freeCouplingPlan() {
+  CouplingPlan& plan = couplingPlan;
+  freeCouplingRequests(plan.momentSendRequests);
+  freeCouplingRequests(plan.momentReceiveRequests);
+  freeCouplingRequests(plan.fieldSendRequests);
+  freeCouplingRequests(plan.fieldReceiveRequests);
+  plan = CouplingPlan();
+}
 
-  //Datastructure for coupling
-  std::map<int, std::set<CellID> > onDccrgMapRemoteProcess; 
-  std::map<int, std::set<CellID> > onFsgridMapRemoteProcess; 
+/* Return the coupling plan, rebuilding it with computeCoupling if the mesh has
+   been repartitioned since it was built (Parameters::meshRepartitionCount) or the
+   local cells differ from the ones it was built for.
+*/
+template <typename T, int stencil> CouplingPlan& getCouplingPlan(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                                                const std::vector<CellID>& cells,
+                                                                FsGrid< T, stencil>& fsgrid) {
+  CouplingPlan& plan = couplingPlan;
+  if (plan.valid && plan.repartitionCount == P::meshRepartitionCount && plan.cells == cells) {
+    return plan;
+  }
+
+  phiprof::start("computeCoupling");
+  std::map<int, std::set<CellID> > onDccrgMapRemoteProcess;
+  std::map<int, std::set<CellID> > onFsgridMapRemoteProcess;
   std::map<CellID, std::vector<int64_t> >  onFsgridMapCells;
-    
-  // map receive process => receive buffers 
-  std::map<int, std::vector<Real> > receivedData; 
+  computeCoupling(mpiGrid, cells, fsgrid, onDccrgMapRemoteProcess, onFsgridMapRemoteProcess, onFsgridMapCells);
 
-  // send buffers  to each process
-  std::map<int, std::vector<Real> > sendData;
+  //index of each dccrg cell in cells, for aggregating received fields
+  std::unordered_map<CellID, size_t> cellIndex;
+  for (size_t i = 0; i < cells.size(); i++) {
+    cellIndex[cells[i]] = i;
+  }
 
-  //list of requests
-  std::vector<MPI_Request> sendRequests;
-  std::vector<MPI_Request> receiveRequests;
- 
-  //computeCoupling
-  computeCoupling(mpiGrid, cells, momentsGrid, onDccrgMapRemoteProcess, onFsgridMapRemoteProcess, onFsgridMapCells);
+  plan.repartitionCount = P::meshRepartitionCount;
+  plan.cells = cells;
+  plan.dccrgProcesses.clear();
+  plan.dccrgProcessStart.assign(1, 0);
+  plan.dccrgCells.clear();
+  plan.dccrgCellIndices.clear();
+  for (auto const &snd : onDccrgMapRemoteProcess) {
+    plan.dccrgProcesses.push_back(snd.first);
+    for (CellID dccrgCell : snd.second) {
+      plan.dccrgCells.push_back(dccrgCell);
+      plan.dccrgCellIndices.push_back(cellIndex[dccrgCell]);
+    }
+    plan.dccrgProcessStart.push_back(plan.dccrgCells.size());
+  }
+
+  plan.fsgridProcesses.clear();
+  plan.fsgridProcessStart.assign(1, 0);
+  plan.fsgridCells.clear();
+  plan.fsgridCellStart.assign(1, 0);
+  plan.fsgridLocalIDs.clear();
+  for (auto const &rcv : onFsgridMapRemoteProcess) {
+    plan.fsgridProcesses.push_back(rcv.first);
+    for (CellID dccrgCell : rcv.second) {
+      plan.fsgridCells.push_back(dccrgCell);
+      auto const &lids = onFsgridMapCells[dccrgCell];
+      plan.fsgridLocalIDs.insert(plan.fsgridLocalIDs.end(), lids.begin(), lids.end());
+      plan.fsgridCellStart.push_back(plan.fsgridLocalIDs.size());
+    }
+    plan.fsgridProcessStart.push_back(plan.fsgridCells.size());
+  }
+
+  plan.dccrgMoments.resize(plan.dccrgCells.size() * fsgrids::moments::N_MOMENTS);
+  plan.fsgridMoments.resize(plan.fsgridCells.size() * fsgrids::moments::N_MOMENTS);
+  plan.dccrgFields.resize(plan.dccrgCells.size());
+  plan.fsgridFields.resize(plan.fsgridCells.size());
+  plan.aggregatedFields.resize(cells.size());
+
+  // Moments go from the dccrg cells to fsgrid, fields from fsgrid back to the dccrg cells.
+  // Message sizes are in bytes, as Real may be float or double. The requests of the
+  // previous plan point to the old buffers and are freed first.
+  freeCouplingRequests(plan.momentSendRequests);
+  freeCouplingRequests(plan.momentReceiveRequests);
+  freeCouplingRequests(plan.fieldSendRequests);
+  freeCouplingRequests(plan.fieldReceiveRequests);
+  const int nMoments = fsgrids::moments::N_MOMENTS;
+  plan.momentSendRequests.resize(plan.dccrgProcesses.size());
+  plan.fieldReceiveRequests.resize(plan.dccrgProcesses.size());
+  for (size_t p = 0; p < plan.dccrgProcesses.size(); p++) {
+    const size_t offset = plan.dccrgProcessStart[p];
+    const int count = plan.dccrgProcessStart[p+1] - offset;
+    MPI_Send_init(plan.dccrgMoments.data() + offset * nMoments, count * nMoments * sizeof(Real),
+                  MPI_BYTE, plan.dccrgProcesses[p], 1, MPI_COMM_WORLD, &(plan.momentSendRequests[p]));
+    MPI_Recv_init(plan.dccrgFields.data() + offset, count * sizeof(Average),
+                  MPI_BYTE, plan.dccrgProcesses[p], 1, MPI_COMM_WORLD, &(plan.fieldReceiveRequests[p]));
+  }
+  plan.momentReceiveRequests.resize(plan.fsgridProcesses.size());
+  plan.fieldSendRequests.resize(plan.fsgridProcesses.size());
+  for (size_t p = 0; p < plan.fsgridProcesses.size(); p++) {
+    const size_t offset = plan.fsgridProcessStart[p];
+    const int count = plan.fsgridProcessStart[p+1] - offset;
+    MPI_Recv_init(plan.fsgridMoments.data() + offset * nMoments, count * nMoments * sizeof(Real),
+                  MPI_BYTE, plan.fsgridProcesses[p], 1, MPI_COMM_WORLD, &(plan.momentReceiveRequests[p]));
+    MPI_Send_init(plan.fsgridFields.data() + offset, count * sizeof(Average),
+                  MPI_BYTE, plan.fsgridProcesses[p], 1, MPI_COMM_WORLD, &(plan.fieldSendRequests[p]));
+  }
+  plan.valid = true;
+  phiprof::stop("computeCoupling");
+  return plan;
+}
+
+void feedMomentsIntoFsGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                           const std::vector<CellID>& cells,
+                           FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2>& momentsGrid, bool dt2 /*=false*/) {
+
+  CouplingPlan& plan = getCouplingPlan(mpiGrid, cells, momentsGrid);
+  const int nMoments = fsgrids::moments::N_MOMENTS;
  
   // Post receives
-  receiveRequests.resize(onFsgridMapRemoteProcess.size());  
-  ii=0;
-  for(auto const &receives: onFsgridMapRemoteProcess){
-    int process = receives.first;
-    int count = receives.second.size();
-    receivedData[process].resize(count * fsgrids::moments::N_MOMENTS);
-    MPI_Irecv(receivedData[process].data(), count * fsgrids::moments::N_MOMENTS * sizeof(Real),
-	      MPI_BYTE, process, 1, MPI_COMM_WORLD,&(receiveRequests[ii++]));
-  }
+  MPI_Startall(plan.momentReceiveRequests.size(), plan.momentReceiveRequests.data());
   
-  // Launch sends
-  ii=0;
-  sendRequests.resize(onDccrgMapRemoteProcess.size());
-  for (auto const &snd : onDccrgMapRemoteProcess){
-    int targetProc = snd.first; 
-    auto& sendBuffer=sendData[targetProc];
-    for(CellID sendCell: snd.second){
-      //Collect data to send for this dccrg cell
-      auto cellParams = mpiGrid[sendCell]->get_cell_parameters();
-      if(!dt2) {
-        sendBuffer.push_back(cellParams[CellParams::RHOM]);
-	sendBuffer.push_back(cellParams[CellParams::RHOQ]);
-	sendBuffer.push_back(cellParams[CellParams::VX]);
-	sendBuffer.push_back(cellParams[CellParams::VY]);
-        sendBuffer.push_back(cellParams[CellParams::VZ]);
-	sendBuffer.push_back(cellParams[CellParams::P_11]);
-	sendBuffer.push_back(cellParams[CellParams::P_22]);
-        sendBuffer.push_back(cellParams[CellParams::P_33]);
-      } else {
-        sendBuffer.push_back(cellParams[CellParams::RHOM_DT2]);
-	sendBuffer.push_back(cellParams[CellParams::RHOQ_DT2]);
-	sendBuffer.push_back(cellParams[CellParams::VX_DT2]);
-	sendBuffer.push_back(cellParams[CellParams::VY_DT2]);
-        sendBuffer.push_back(cellParams[CellParams::VZ_DT2]);
-	sendBuffer.push_back(cellParams[CellParams::P_11_DT2]);
-	sendBuffer.push_back(cellParams[CellParams::P_22_DT2]);
-        sendBuffer.push_back(cellParams[CellParams::P_33_DT2]);
-      }
+  //Collect data to send for each dccrg cell, the same cell may be sent to several processes
+  #pragma omp parallel for
+  for (size_t c = 0; c < plan.dccrgCells.size(); c++) {
+    const Real* cellParams = mpiGrid[plan.dccrgCells[c]]->get_cell_parameters();
+    Real* sendBuffer = plan.dccrgMoments.data() + c * nMoments;
+    if(!dt2) {
+      sendBuffer[0] = cellParams[CellParams::RHOM];
+      sendBuffer[1] = cellParams[CellParams::RHOQ];
+      sendBuffer[2] = cellParams[CellParams::VX];
+      sendBuffer[3] = cellParams[CellParams::VY];
+      sendBuffer[4] = cellParams[CellParams::VZ];
+      sendBuffer[5] = cellParams[CellParams::P_11];
+      sendBuffer[6] = cellParams[CellParams::P_22];
+      sendBuffer[7] = cellParams[CellParams::P_33];
+    } else {
+      sendBuffer[0] = cellParams[CellParams::RHOM_DT2];
+      sendBuffer[1] = cellParams[CellParams::RHOQ_DT2];
+      sendBuffer[2] = cellParams[CellParams::VX_DT2];
+      sendBuffer[3] = cellParams[CellParams::VY_DT2];
+      sendBuffer[4] = cellParams[CellParams::VZ_DT2];
+      sendBuffer[5] = cellParams[CellParams::P_11_DT2];
+      sendBuffer[6] = cellParams[CellParams::P_22_DT2];
+      sendBuffer[7] = cellParams[CellParams::P_33_DT2];
     }
-    int count = sendBuffer.size(); //note, compared to receive this includes all elements to be sent
-    MPI_Isend(sendBuffer.data(), sendBuffer.size() * sizeof(Real),
-	      MPI_BYTE, targetProc, 1, MPI_COMM_WORLD,&(sendRequests[ii]));
-    ii++;
   }
 
+  // Launch sends
+  MPI_Startall(plan.momentSendRequests.size(), plan.momentSendRequests.data());
+
   
-  MPI_Waitall(receiveRequests.size(), receiveRequests.data(), MPI_STATUSES_IGNORE);
-
-  for(auto const &receives: onFsgridMapRemoteProcess){
-    int process = receives.first; //data received from this process
-    Real* receiveBuffer = receivedData[process].data(); // data received from process
-    for(auto const &cell: receives.second){ //loop over cellids (dccrg) for receive
-      // this part heavily relies on both sender and receiver having cellids sorted!
-      for(auto lid: onFsgridMapCells[cell]){
-	std::array<Real, fsgrids::moments::N_MOMENTS> * fsgridData = momentsGrid.get(lid);
-	for(int l = 0; l < fsgrids::moments::N_MOMENTS; l++)   {
-	  fsgridData->at(l) = receiveBuffer[l];
-	}
+  MPI_Waitall(plan.momentReceiveRequests.size(), plan.momentReceiveRequests.data(), MPI_STATUSES_IGNORE);
+
+  // this part heavily relies on both sender and receiver having cellids sorted!
+  #pragma omp parallel for
+  for (size_t c = 0; c < plan.fsgridCells.size(); c++) {
+    const Real* receiveBuffer = plan.fsgridMoments.data() + c * nMoments;
+    for (size_t i = plan.fsgridCellStart[c]; i < plan.fsgridCellStart[c+1]; i++) {
+      std::array<Real, fsgrids::moments::N_MOMENTS> * fsgridData = momentsGrid.get(plan.fsgridLocalIDs[i]);
+      for(int l = 0; l < nMoments; l++)   {
+        fsgridData->at(l) = receiveBuffer[l];
       }
-      
-      receiveBuffer+=fsgrids::moments::N_MOMENTS;
     }
   }
 
-  MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
+  MPI_Waitall(plan.momentSendRequests.size(), plan.momentSendRequests.data(), MPI_STATUSES_IGNORE);
 
 }
 
@@ -190,170 +344,100 @@ void getFieldsFromFsGrid(
    const std::vector<CellID>& cells
 ) {
   // TODO: solver only needs bgb + PERB, we could combine them
-  
-  const int fieldsToCommunicate = 21;
-  struct Average {
-    Real sums[fieldsToCommunicate];
-    int cells;
-    Average()  {
-      cells = 0;
-      for(int i = 0; i < fieldsToCommunicate; i++){
-         sums[i] = 0;
-      }
-    }
-    Average operator+=(const Average& rhs) {
-      this->cells += rhs.cells;
-      for(int i = 0; i < fieldsToCommunicate; i++){
-         this->sums[i] += rhs.sums[i];
-      }
-    return *this;
-    }
-  };
 
-    
-  int ii;
-  //sorted list of dccrg cells. cells is typicall already sorted, but just to make sure....
-  std::vector<CellID> dccrgCells = cells;
-  std::sort(dccrgCells.begin(), dccrgCells.end());
-
-  //Datastructure for coupling
-  std::map<int, std::set<CellID> > onDccrgMapRemoteProcess; 
-  std::map<int, std::set<CellID> > onFsgridMapRemoteProcess; 
-  std::map<CellID, std::vector<int64_t> >  onFsgridMapCells;
-    
-  // map receive process => receive buffers 
-  std::map<int, std::vector<Average> > receivedData; 
-
-  // send buffers  to each process
-  std::map<int, std::vector<Average> > sendData;
-
-  // map where we finally aggregate result for each local dccrg cell
-  std::map<CellID, Average> aggregatedResult;
-
-  //list of requests
-  std::vector<MPI_Request> sendRequests;
-  std::vector<MPI_Request> receiveRequests;
-
-  
-  //computeCoupling
-  computeCoupling(mpiGrid, cells, volumeFieldsGrid, onDccrgMapRemoteProcess, onFsgridMapRemoteProcess, onFsgridMapCells);
+  CouplingPlan& plan = getCouplingPlan(mpiGrid, cells, volumeFieldsGrid);
 
   //post receives
-  ii=0;
-  receiveRequests.resize(onDccrgMapRemoteProcess.size());
-  for (auto const &rcv : onDccrgMapRemoteProcess){
-    int remoteRank = rcv.first; 
-    int count = rcv.second.size();
-    auto& receiveBuffer=receivedData[remoteRank];
-    
-    receiveBuffer.resize(count);
-    MPI_Irecv(receiveBuffer.data(), count * sizeof(Average),
-		 MPI_BYTE, remoteRank, 1, MPI_COMM_WORLD,&(receiveRequests[ii++]));
-  }
+  MPI_Startall(plan.fieldReceiveRequests.size(), plan.fieldReceiveRequests.data());
 
   //compute average and weight for each field that we want to send to dccrg grid
-  for(auto const &snd: onFsgridMapRemoteProcess){
-    int remoteRank = snd.first;
-    int count = snd.second.size();
-    auto& sendBuffer = sendData[remoteRank];
-    sendBuffer.resize(count);
-    
-    ii=0;
-    for(auto const dccrgCell: snd.second){
-      //loop over dccrg cells to which we shall send data for this remoteRank
-      auto const &fsgridCells = onFsgridMapCells[dccrgCell];
-      for (auto const fsgridCell: fsgridCells){
-        //loop over fsgrid cells for which we compute the average that is sent to dccrgCell on rank remoteRank
-        if(technicalGrid.get(fsgridCell)->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-           continue;
-        }
-        std::array<Real, fsgrids::volfields::N_VOL> * volcell = volumeFieldsGrid.get(fsgridCell);
-	std::array<Real, fsgrids::bgbfield::N_BGB> * bgcell = BgBGrid.get(fsgridCell);
-	std::array<Real, fsgrids::egradpe::N_EGRADPE> * egradpecell = EGradPeGrid.get(fsgridCell);	
-	
-        sendBuffer[ii].sums[0 ] += volcell->at(fsgrids::volfields::PERBXVOL);
-        sendBuffer[ii].sums[1 ] += volcell->at(fsgrids::volfields::PERBYVOL);
-        sendBuffer[ii].sums[2 ] += volcell->at(fsgrids::volfields::PERBZVOL);
-        sendBuffer[ii].sums[6 ] += volcell->at(fsgrids::volfields::dPERBXVOLdy) / technicalGrid.DY;
-        sendBuffer[ii].sums[7 ] += volcell->at(fsgrids::volfields::dPERBXVOLdz) / technicalGrid.DZ;
-        sendBuffer[ii].sums[8 ] += volcell->at(fsgrids::volfields::dPERBYVOLdx) / technicalGrid.DX;
-        sendBuffer[ii].sums[9 ] += volcell->at(fsgrids::volfields::dPERBYVOLdz) / technicalGrid.DZ;
-        sendBuffer[ii].sums[10] += volcell->at(fsgrids::volfields::dPERBZVOLdx) / technicalGrid.DX;
-        sendBuffer[ii].sums[11] += volcell->at(fsgrids::volfields::dPERBZVOLdy) / technicalGrid.DY;
-        sendBuffer[ii].sums[12] += bgcell->at(fsgrids::bgbfield::BGBXVOL);
-        sendBuffer[ii].sums[13] += bgcell->at(fsgrids::bgbfield::BGBYVOL);
-        sendBuffer[ii].sums[14] += bgcell->at(fsgrids::bgbfield::BGBZVOL);
-        sendBuffer[ii].sums[15] += egradpecell->at(fsgrids::egradpe::EXGRADPE);
-        sendBuffer[ii].sums[16] += egradpecell->at(fsgrids::egradpe::EYGRADPE);
-        sendBuffer[ii].sums[17] += egradpecell->at(fsgrids::egradpe::EZGRADPE);
-	sendBuffer[ii].sums[18] += volcell->at(fsgrids::volfields::EXVOL);
-	sendBuffer[ii].sums[19] += volcell->at(fsgrids::volfields::EYVOL);
-	sendBuffer[ii].sums[20] += volcell->at(fsgrids::volfields::EZVOL);
-        sendBuffer[ii].cells++;
+  #pragma omp parallel for
+  for (size_t c = 0; c < plan.fsgridCells.size(); c++) {
+    Average& sendBuffer = plan.fsgridFields[c];
+    sendBuffer = Average();
+    for (size_t i = plan.fsgridCellStart[c]; i < plan.fsgridCellStart[c+1]; i++) {
+      //loop over fsgrid cells for which we compute the average that is sent to the dccrg cell
+      const int64_t fsgridCell = plan.fsgridLocalIDs[i];
+      if(technicalGrid.get(fsgridCell)->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
+         continue;
       }
-      ii++;
+      std::array<Real, fsgrids::volfields::N_VOL> * volcell = volumeFieldsGrid.get(fsgridCell);
+      std::array<Real, fsgrids::bgbfield::N_BGB> * bgcell = BgBGrid.get(fsgridCell);
+      std::array<Real, fsgrids::egradpe::N_EGRADPE> * egradpecell = EGradPeGrid.get(fsgridCell);	
+	
+      sendBuffer.sums[0 ] += volcell->at(fsgrids::volfields::PERBXVOL);
+      sendBuffer.sums[1 ] += volcell->at(fsgrids::volfields::PERBYVOL);
+      sendBuffer.sums[2 ] += volcell->at(fsgrids::volfields::PERBZVOL);
+      sendBuffer.sums[6 ] += volcell->at(fsgrids::volfields::dPERBXVOLdy) / technicalGrid.DY;
+      sendBuffer.sums[7 ] += volcell->at(fsgrids::volfields::dPERBXVOLdz) / technicalGrid.DZ;
+      sendBuffer.sums[8 ] += volcell->at(fsgrids::volfields::dPERBYVOLdx) / technicalGrid.DX;
+      sendBuffer.sums[9 ] += volcell->at(fsgrids::volfields::dPERBYVOLdz) / technicalGrid.DZ;
+      sendBuffer.sums[10] += volcell->at(fsgrids::volfields::dPERBZVOLdx) / technicalGrid.DX;
+      sendBuffer.sums[11] += volcell->at(fsgrids::volfields::dPERBZVOLdy) / technicalGrid.DY;
+      sendBuffer.sums[12] += bgcell->at(fsgrids::bgbfield::BGBXVOL);
+      sendBuffer.sums[13] += bgcell->at(fsgrids::bgbfield::BGBYVOL);
+      sendBuffer.sums[14] += bgcell->at(fsgrids::bgbfield::BGBZVOL);
+      sendBuffer.sums[15] += egradpecell->at(fsgrids::egradpe::EXGRADPE);
+      sendBuffer.sums[16] += egradpecell->at(fsgrids::egradpe::EYGRADPE);
+      sendBuffer.sums[17] += egradpecell->at(fsgrids::egradpe::EZGRADPE);
+      sendBuffer.sums[18] += volcell->at(fsgrids::volfields::EXVOL);
+      sendBuffer.sums[19] += volcell->at(fsgrids::volfields::EYVOL);
+      sendBuffer.sums[20] += volcell->at(fsgrids::volfields::EZVOL);
+      sendBuffer.cells++;
     }
   }
   
   //post sends
-  sendRequests.resize(onFsgridMapRemoteProcess.size());
-  ii=0;
-  for(auto const &sends: onFsgridMapRemoteProcess){
-    int remoteRank = sends.first;
-    int count = sends.second.size();
-    MPI_Isend(sendData[remoteRank].data(), count * sizeof(Average),
-	     MPI_BYTE, remoteRank, 1, MPI_COMM_WORLD,&(sendRequests[ii++]));
-  }
+  MPI_Startall(plan.fieldSendRequests.size(), plan.fieldSendRequests.data());
   
-  MPI_Waitall(receiveRequests.size(), receiveRequests.data(), MPI_STATUSES_IGNORE);
-
-
-  //Aggregate receives, compute the weighted average of these
-  ii=0;
-  for (auto const &rcv : onDccrgMapRemoteProcess){
-    int remoteRank = rcv.first; 
-    std::vector<Average>& receiveBuffer=receivedData[remoteRank];
-    ii=0;
-    for (CellID dccrgCell: rcv.second ) {
-      //aggregate result. Average strct has operator += and a constructor
-      aggregatedResult[dccrgCell] += receiveBuffer[ii++];
-    }
+  MPI_Waitall(plan.fieldReceiveRequests.size(), plan.fieldReceiveRequests.data(), MPI_STATUSES_IGNORE);
+
+
+  //Aggregate receives, compute the weighted average of these. A dccrg cell
+  //overlapping several fsgrid domains receives a partial result from each of them.
+  std::fill(plan.aggregatedFields.begin(), plan.aggregatedFields.end(), Average());
+  for (size_t c = 0; c < plan.dccrgCells.size(); c++) {
+    //aggregate result. Average strct has operator += and a constructor
+    plan.aggregatedFields[plan.dccrgCellIndices[c]] += plan.dccrgFields[c];
   }
   
   //Store data in dccrg
-  for (auto const &cellAggregate : aggregatedResult) {
-    auto cellParams = mpiGrid[cellAggregate.first]->get_cell_parameters();
-    if ( cellAggregate.second.cells > 0) {
-      cellParams[CellParams::PERBXVOL] = cellAggregate.second.sums[0] / cellAggregate.second.cells;
-      cellParams[CellParams::PERBYVOL] = cellAggregate.second.sums[1] / cellAggregate.second.cells;
-      cellParams[CellParams::PERBZVOL] = cellAggregate.second.sums[2] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBXVOLdy] = cellAggregate.second.sums[6] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBXVOLdz] = cellAggregate.second.sums[7] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBYVOLdx] = cellAggregate.second.sums[8] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBYVOLdz] = cellAggregate.second.sums[9] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBZVOLdx] = cellAggregate.second.sums[10] / cellAggregate.second.cells;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBZVOLdy] = cellAggregate.second.sums[11] / cellAggregate.second.cells;
-      cellParams[CellParams::BGBXVOL]  = cellAggregate.second.sums[12] / cellAggregate.second.cells;
-      cellParams[CellParams::BGBYVOL]  = cellAggregate.second.sums[13] / cellAggregate.second.cells;
-      cellParams[CellParams::BGBZVOL]  = cellAggregate.second.sums[14] / cellAggregate.second.cells;
-      cellParams[CellParams::EXGRADPE] = cellAggregate.second.sums[15] / cellAggregate.second.cells;
-      cellParams[CellParams::EYGRADPE] = cellAggregate.second.sums[16] / cellAggregate.second.cells;
-      cellParams[CellParams::EZGRADPE] = cellAggregate.second.sums[17] / cellAggregate.second.cells;
-      cellParams[CellParams::EXVOL] = cellAggregate.second.sums[18] / cellAggregate.second.cells;
-      cellParams[CellParams::EYVOL] = cellAggregate.second.sums[19] / cellAggregate.second.cells;
-      cellParams[CellParams::EZVOL] = cellAggregate.second.sums[20] / cellAggregate.second.cells;
+  #pragma omp parallel for
+  for (size_t i = 0; i < cells.size(); i++) {
+    const Average& cellAggregate = plan.aggregatedFields[i];
+    SpatialCell* cell = mpiGrid[cells[i]];
+    auto cellParams = cell->get_cell_parameters();
+    if ( cellAggregate.cells > 0) {
+      cellParams[CellParams::PERBXVOL] = cellAggregate.sums[0] / cellAggregate.cells;
+      cellParams[CellParams::PERBYVOL] = cellAggregate.sums[1] / cellAggregate.cells;
+      cellParams[CellParams::PERBZVOL] = cellAggregate.sums[2] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBXVOLdy] = cellAggregate.sums[6] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBXVOLdz] = cellAggregate.sums[7] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBYVOLdx] = cellAggregate.sums[8] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBYVOLdz] = cellAggregate.sums[9] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBZVOLdx] = cellAggregate.sums[10] / cellAggregate.cells;
+      cell->derivativesBVOL[bvolderivatives::dPERBZVOLdy] = cellAggregate.sums[11] / cellAggregate.cells;
+      cellParams[CellParams::BGBXVOL]  = cellAggregate.sums[12] / cellAggregate.cells;
+      cellParams[CellParams::BGBYVOL]  = cellAggregate.sums[13] / cellAggregate.cells;
+      cellParams[CellParams::BGBZVOL]  = cellAggregate.sums[14] / cellAggregate.cells;
+      cellParams[CellParams::EXGRADPE] = cellAggregate.sums[15] / cellAggregate.cells;
+      cellParams[CellParams::EYGRADPE] = cellAggregate.sums[16] / cellAggregate.cells;
+      cellParams[CellParams::EZGRADPE] = cellAggregate.sums[17] / cellAggregate.cells;
+      cellParams[CellParams::EXVOL] = cellAggregate.sums[18] / cellAggregate.cells;
+      cellParams[CellParams::EYVOL] = cellAggregate.sums[19] / cellAggregate.cells;
+      cellParams[CellParams::EZVOL] = cellAggregate.sums[20] / cellAggregate.cells;
     }
     else{
       // This could happpen if all fsgrid cells are do not compute
       cellParams[CellParams::PERBXVOL] = 0;
       cellParams[CellParams::PERBYVOL] = 0;
       cellParams[CellParams::PERBZVOL] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBXVOLdy] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBXVOLdz] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBYVOLdx] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBYVOLdz] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBZVOLdx] = 0;
-      mpiGrid[cellAggregate.first]->derivativesBVOL[bvolderivatives::dPERBZVOLdy] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBXVOLdy] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBXVOLdz] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBYVOLdx] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBYVOLdz] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBZVOLdx] = 0;
+      cell->derivativesBVOL[bvolderivatives::dPERBZVOLdy] = 0;
       cellParams[CellParams::BGBXVOL]  = 0;
       cellParams[CellParams::BGBYVOL]  = 0;
       cellParams[CellParams::BGBZVOL]  = 0;
@@ -366,7 +450,7 @@ void getFieldsFromFsGrid(
     }
   }
   
-  MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
+  MPI_Waitall(plan.fieldSendRequests.size(), plan.fieldSendRequests.data(), MPI_STATUSES_IGNORE);
   
 }
 
@@ -19,6 +19,11 @@ void feedMomentsIntoFsGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                            FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2>& momentsGrid,
                            bool dt2=false);
 
+/*! Free the persistent MPI requests of the cached dccrg <=> fsgrid coupling.
+ * Call once at shutdown, before MPI_Finalize.
+ */
+void freeCouplingPlan();
+
 /*! Copy field solver result (VOLB, VOLE, VOLPERB derivatives, gradpe) and store them back into DCCRG
  * \param mpiGrid The DCCRG grid carrying fields.
  * \param cells List of local cells
@@ -24,6 +24,11 @@
 
 #include "fs_common.h"
 #include "ldz_electric_field.hpp"
+#include "ldz_hall.hpp"
+
+#ifdef _OPENMP
+   #include <omp.h>
+#endif
 
 #ifndef NDEBUG
    #define DEBUG_FSOLVER
@@ -32,6 +37,45 @@
 namespace pc = physicalconstants;
 using namespace std;
 
+/*! \brief Access to the fsGrid cells around one row of cells along x.
+ *
+ * The edge electric field of cell (i,j,k) needs cells j-1..j+1 and k-1..k+1. The pointers to the
+ * start of these nine rows are looked up once per row, after which get(i,j,k) is plain pointer
+ * arithmetic instead of the checked FsGrid::get, which saves the bounds and neighbour checks
+ * of every access in the edge electric field computation.
+ */
+template <typename T> class FsGridRowStencil {
+public:
+   /*! \param grid fsGrid to access
+    * \param j,k fsGrid cell coordinates of the row being computed
+    */
+   FsGridRowStencil(FsGrid<T, 2> & grid, cint j, cint k): DX(grid.DX), DY(grid.DY), DZ(grid.DZ), j0(j), k0(k) {
+      // In dimensions with only one cell fsGrid has no ghost cells and ignores that coordinate
+      const int64_t origin = grid.LocalIDForCoords(0,0,0);
+      xStride = grid.LocalIDForCoords(1,0,0) - origin;
+      for (int dk=-1; dk<=1; dk++) {
+         for (int dj=-1; dj<=1; dj++) {
+            rows[(dk+1)*3 + dj+1] = grid.get(origin) + (grid.LocalIDForCoords(0,j+dj,k+dk) - origin);
+         }
+      }
+   }
+
+   T* get(cint i, cint j, cint k) const {
+      return rows[(k-k0+1)*3 + j-j0+1] + i*xStride;
+   }
+
+   const Real DX, DY, DZ;
+private:
+   const int j0, k0;
+   int64_t xStride;
+   T* rows[9];
+};
+
+/*! \brief Per-cell access to fsGrid through the checked FsGrid::get, the other accessor of the
+ * edge electric field functions. Used when P::fieldSolverRowStencil is off.
+ */
+template <typename T> using FsGridCells = FsGrid<T, 2>;
+
 /*! \brief Low-level helper function.
  *
  * Computes the correct combination of speeds to determine the CFL limits.
@@ -49,7 +93,7 @@ using namespace std;
  * \param vS Sound speed
  * \param vW Whistler speed
  */
-Real calculateCflSpeed(
+inline Real calculateCflSpeed(
    const Real& v0,
    const Real& v1,
    const Real& vA,
@@ -92,12 +136,13 @@ Real calculateCflSpeed(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
-void calculateWaveSpeedYZ(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
+template <template <typename> class Grid>
+inline void calculateWaveSpeedYZ(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
    cint i,
    cint j,
    cint k,
@@ -206,12 +251,13 @@ void calculateWaveSpeedYZ(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
-void calculateWaveSpeedXZ(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
+template <template <typename> class Grid>
+inline void calculateWaveSpeedXZ(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
    cint i,
    cint j,
    cint k,
@@ -320,12 +366,13 @@ void calculateWaveSpeedXZ(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
-void calculateWaveSpeedXY(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
+template <template <typename> class Grid>
+inline void calculateWaveSpeedXY(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
    cint i,
    cint j,
    cint k,
@@ -424,16 +471,17 @@ void calculateWaveSpeedXY(
  * \param i,j,k fsGrid cell coordinates for the current cell
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
-void calculateEdgeElectricFieldX(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, 2> & EGrid,
-   FsGrid< std::array<Real, fsgrids::ehall::N_EHALL>, 2> & EHallGrid,
-   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
-   FsGrid< fsgrids::technical, 2> & technicalGrid,
+template <template <typename> class Grid>
+inline void calculateEdgeElectricFieldX(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::efield::N_EFIELD> > & EGrid,
+   Grid< std::array<Real, fsgrids::ehall::N_EHALL> > & EHallGrid,
+   Grid< std::array<Real, fsgrids::egradpe::N_EGRADPE> > & EGradPeGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
+   Grid< fsgrids::technical > & technicalGrid,
    cint i,
    cint j,
    cint k,
@@ -562,7 +610,7 @@ void calculateEdgeElectricFieldX(
       Ex_SW += +HALF*((By_S - HALF*dBydz_S)*(-dmoments_SW->at(fsgrids::dmoments::dVzdy) - dmoments_SW->at(fsgrids::dmoments::dVzdz)) - dBydz_S*Vz0 + SIXTH*dBydx_S*dmoments_SW->at(fsgrids::dmoments::dVzdx));
       Ex_SW += -HALF*((Bz_W - HALF*dBzdy_W)*(-dmoments_SW->at(fsgrids::dmoments::dVydy) - dmoments_SW->at(fsgrids::dmoments::dVydz)) - dBzdy_W*Vy0 + SIXTH*dBzdx_W*dmoments_SW->at(fsgrids::dmoments::dVydx));
    #endif
-   calculateWaveSpeedYZ(
+   calculateWaveSpeedYZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -618,7 +666,7 @@ void calculateEdgeElectricFieldX(
       Ex_SE += -HALF*((Bz_E + HALF*dBzdy_E)*(+dmoments_SE->at(fsgrids::dmoments::dVydy) - dmoments_SE->at(fsgrids::dmoments::dVydz)) + dBzdy_E*Vy0 + SIXTH*dBzdx_E*dmoments_SE->at(fsgrids::dmoments::dVydx));
    #endif
    
-   calculateWaveSpeedYZ(
+   calculateWaveSpeedYZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -674,7 +722,7 @@ void calculateEdgeElectricFieldX(
       Ex_NW += -HALF*((Bz_W - HALF*dBzdy_W)*(-dmoments_NW->at(fsgrids::dmoments::dVydy) + dmoments_NW->at(fsgrids::dmoments::dVydz)) - dBzdy_W*Vy0 + SIXTH*dBzdx_W*dmoments_NW->at(fsgrids::dmoments::dVydx));
    #endif
    
-   calculateWaveSpeedYZ(
+   calculateWaveSpeedYZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -730,7 +778,7 @@ void calculateEdgeElectricFieldX(
       Ex_NE += -HALF*((Bz_E + HALF*dBzdy_E)*(+dmoments_NE->at(fsgrids::dmoments::dVydy) + dmoments_NE->at(fsgrids::dmoments::dVydz)) + dBzdy_E*Vy0 + SIXTH*dBzdx_E*dmoments_NE->at(fsgrids::dmoments::dVydx));
    #endif
    
-   calculateWaveSpeedYZ(
+   calculateWaveSpeedYZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -782,16 +830,17 @@ void calculateEdgeElectricFieldX(
  * 
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
-void calculateEdgeElectricFieldY(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, 2> & EGrid,
-   FsGrid< std::array<Real, fsgrids::ehall::N_EHALL>, 2> & EHallGrid,
-   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
-   FsGrid< fsgrids::technical, 2> & technicalGrid,
+template <template <typename> class Grid>
+inline void calculateEdgeElectricFieldY(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::efield::N_EFIELD> > & EGrid,
+   Grid< std::array<Real, fsgrids::ehall::N_EHALL> > & EHallGrid,
+   Grid< std::array<Real, fsgrids::egradpe::N_EGRADPE> > & EGradPeGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
+   Grid< fsgrids::technical > & technicalGrid,
    cint i,
    cint j,
    cint k,
@@ -920,7 +969,7 @@ void calculateEdgeElectricFieldY(
       Ey_SW += -HALF*((Bx_W - HALF*dBxdz_W)*(-dmoments_SW->at(fsgrids::dmoments::dVzdx) - dmoments_SW->at(fsgrids::dmoments::dVzdz)) - dBxdz_W*Vz0 + SIXTH*dBxdy_W*dmoments_SW->at(fsgrids::dmoments::dVzdy));
    #endif
    
-   calculateWaveSpeedXZ(
+   calculateWaveSpeedXZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -976,7 +1025,7 @@ void calculateEdgeElectricFieldY(
       Ey_SE += -HALF*((Bx_E + HALF*dBxdz_E)*(-dmoments_SE->at(fsgrids::dmoments::dVzdx) + dmoments_SE->at(fsgrids::dmoments::dVzdz)) + dBxdz_E*Vz0 + SIXTH*dBxdy_E*dmoments_SE->at(fsgrids::dmoments::dVzdy));
    #endif
    
-   calculateWaveSpeedXZ(
+   calculateWaveSpeedXZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1032,7 +1081,7 @@ void calculateEdgeElectricFieldY(
       Ey_NW += -HALF*((Bx_W - HALF*dBxdz_W)*(+dmoments_NW->at(fsgrids::dmoments::dVzdx) - dmoments_NW->at(fsgrids::dmoments::dVzdz)) - dBxdz_W*Vz0 + SIXTH*dBxdy_W*dmoments_NW->at(fsgrids::dmoments::dVzdy));
    #endif
    
-   calculateWaveSpeedXZ(
+   calculateWaveSpeedXZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1088,7 +1137,7 @@ void calculateEdgeElectricFieldY(
       Ey_NE += -HALF*((Bx_E + HALF*dBxdz_E)*(+dmoments_NE->at(fsgrids::dmoments::dVzdx) + dmoments_NE->at(fsgrids::dmoments::dVzdz)) + dBxdz_E*Vz0 + SIXTH*dBxdy_E*dmoments_NE->at(fsgrids::dmoments::dVzdy));
    #endif
    
-   calculateWaveSpeedXZ(
+   calculateWaveSpeedXZ<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1139,16 +1188,17 @@ void calculateEdgeElectricFieldY(
  * 
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
-void calculateEdgeElectricFieldZ(
-   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
-   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, 2> & EGrid,
-   FsGrid< std::array<Real, fsgrids::ehall::N_EHALL>, 2> & EHallGrid,
-   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
-   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
-   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
-   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
-   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
-   FsGrid< fsgrids::technical, 2> & technicalGrid,
+template <template <typename> class Grid>
+inline void calculateEdgeElectricFieldZ(
+   Grid< std::array<Real, fsgrids::bfield::N_BFIELD> > & perBGrid,
+   Grid< std::array<Real, fsgrids::efield::N_EFIELD> > & EGrid,
+   Grid< std::array<Real, fsgrids::ehall::N_EHALL> > & EHallGrid,
+   Grid< std::array<Real, fsgrids::egradpe::N_EGRADPE> > & EGradPeGrid,
+   Grid< std::array<Real, fsgrids::moments::N_MOMENTS> > & momentsGrid,
+   Grid< std::array<Real, fsgrids::dperb::N_DPERB> > & dPerBGrid,
+   Grid< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > & dMomentsGrid,
+   Grid< std::array<Real, fsgrids::bgbfield::N_BGB> > & BgBGrid,
+   Grid< fsgrids::technical > & technicalGrid,
    cint i,
    cint j,
    cint k,
@@ -1281,7 +1331,7 @@ void calculateEdgeElectricFieldZ(
    
    // Calculate maximum wave speed (fast magnetosonic speed) on SW cell. In order 
    // to get Alfven speed we need to calculate some reconstruction coeff. for Bz:
-   calculateWaveSpeedXY(
+   calculateWaveSpeedXY<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1337,7 +1387,7 @@ void calculateEdgeElectricFieldZ(
       Ez_SE  += -HALF*((By_E + HALF*dBydx_E)*(+dmoments_SE->at(fsgrids::dmoments::dVxdx) - dmoments_SE->at(fsgrids::dmoments::dVxdy)) + dBydx_E*Vx0 + SIXTH*dBydz_E*dmoments_SE->at(fsgrids::dmoments::dVxdz));
    #endif
    
-   calculateWaveSpeedXY(
+   calculateWaveSpeedXY<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1393,7 +1443,7 @@ void calculateEdgeElectricFieldZ(
       Ez_NW  += -HALF*((By_W - HALF*dBydx_W)*(-dmoments_NW->at(fsgrids::dmoments::dVxdx) + dmoments_NW->at(fsgrids::dmoments::dVxdy)) - dBydx_W*Vx0 + SIXTH*dBydz_W*dmoments_NW->at(fsgrids::dmoments::dVxdz));
    #endif
    
-   calculateWaveSpeedXY(
+   calculateWaveSpeedXY<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1449,7 +1499,7 @@ void calculateEdgeElectricFieldZ(
       Ez_NE  += -HALF*((By_E + HALF*dBydx_E)*(+dmoments_NE->at(fsgrids::dmoments::dVxdx) + dmoments_NE->at(fsgrids::dmoments::dVxdy)) + dBydx_E*Vx0 + SIXTH*dBydz_E*dmoments_NE->at(fsgrids::dmoments::dVxdz));
    #endif
    
-   calculateWaveSpeedXY(
+   calculateWaveSpeedXY<Grid>(
       perBGrid,
       momentsGrid,
       dPerBGrid,
@@ -1493,7 +1543,8 @@ void calculateEdgeElectricFieldZ(
 
 /*! \brief Electric field propagation function.
  * 
- * Calls the general or the system boundary electric field propagation functions.
+ * Calls the general or the system boundary electric field propagation functions for the cell (i,j,k),
+ * accessing the grids cell by cell. Used when P::fieldSolverRowStencil is off.
  * 
  * \param perBGrid fsGrid holding the perturbed B quantities
  * \param EGrid fsGrid holding the electric field
@@ -1508,7 +1559,7 @@ void calculateEdgeElectricFieldZ(
  * \param sysBoundaries System boundary conditions existing
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  * 
- * \sa calculateUpwindedElectricFieldSimple calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
+ * \sa calculateElectricFieldRow calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
  * 
  */
 void calculateElectricField(
@@ -1534,7 +1585,7 @@ void calculateElectricField(
    cuint bitfield = technicalGrid.get(i,j,k)->SOLVE;
    
    if ((bitfield & compute::EX) == compute::EX) {
-      calculateEdgeElectricFieldX(
+      calculateEdgeElectricFieldX<FsGridCells>(
          perBGrid,
          EGrid,
          EHallGrid,
@@ -1554,7 +1605,7 @@ void calculateElectricField(
    }
    
    if ((bitfield & compute::EY) == compute::EY) {
-      calculateEdgeElectricFieldY(
+      calculateEdgeElectricFieldY<FsGridCells>(
          perBGrid,
          EGrid,
          EHallGrid,
@@ -1574,7 +1625,7 @@ void calculateElectricField(
    }
    
    if ((bitfield & compute::EZ) == compute::EZ) {
-      calculateEdgeElectricFieldZ(
+      calculateEdgeElectricFieldZ<FsGridCells>(
          perBGrid,
          EGrid,
          EHallGrid,
@@ -1594,10 +1645,178 @@ void calculateElectricField(
    }
 }
 
+/*! \brief Electric field propagation function.
+ * 
+ * Calls the general or the system boundary electric field propagation functions for the cells (iStart..iEnd-1,j,k).
+ * 
+ * The cells are first sorted into lists of cells computing each edge component, calling the system
+ * boundary functions for the rest. The edge electric fields are then computed over the lists, one
+ * component at a time, so that each loop runs the same kernel without per-cell branching on SOLVE.
+ * 
+ * The grids are accessed through FsGridRowStencil, which looks up the rows around the current row
+ * once instead of checking every access. With P::fieldSolverRowStencil off, the cells are instead
+ * computed one by one with calculateElectricField.
+ * 
+ * \param perBGrid fsGrid holding the perturbed B quantities
+ * \param EGrid fsGrid holding the electric field
+ * \param EHallGrid fsGrid holding the Hall contributions to the electric field
+ * \param EGradPeGrid fsGrid holding the electron pressure gradient E field
+ * \param momentsGrid fsGrid holding the moment quantities
+ * \param dPerBGrid fsGrid holding the derivatives of perturbed B
+ * \param dMomentsGrid fsGrid holding the derviatives of moments
+ * \param BgBGrid fsGrid holding the background B quantities
+ * \param technicalGrid fsGrid holding technical information (such as boundary types)
+ * \param j,k fsGrid cell coordinates for the current row of cells
+ * \param iStart,iEnd Range of cells computed along the row
+ * \param cells Work space for the lists of computed cells, one per edge component
+ * \param sysBoundaries System boundary conditions existing
+ * \param RKCase Element in the enum defining the Runge-Kutta method steps
+ * 
+ * \sa calculateUpwindedElectricFieldSimple calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
+ * 
+ */
+void calculateElectricFieldRow(
+   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
+   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, 2> & EGrid,
+   FsGrid< std::array<Real, fsgrids::ehall::N_EHALL>, 2> & EHallGrid,
+   FsGrid< std::array<Real, fsgrids::egradpe::N_EGRADPE>, 2> & EGradPeGrid,
+   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & momentsGrid,
+   FsGrid< std::array<Real, fsgrids::dperb::N_DPERB>, 2> & dPerBGrid,
+   FsGrid< std::array<Real, fsgrids::dmoments::N_DMOMENTS>, 2> & dMomentsGrid,
+   FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
+   FsGrid< fsgrids::technical, 2> & technicalGrid,
+   cint j,
+   cint k,
+   cint iStart,
+   cint iEnd,
+   std::array<std::vector<int>, 3> & cells,
+   SysBoundary& sysBoundaries,
+   cint& RKCase
+) {
+   if (!Parameters::fieldSolverRowStencil) {
+      for (int i=iStart; i<iEnd; i++) {
+         calculateElectricField(
+            perBGrid,
+            EGrid,
+            EHallGrid,
+            EGradPeGrid,
+            momentsGrid,
+            dPerBGrid,
+            dMomentsGrid,
+            BgBGrid,
+            technicalGrid,
+            i,
+            j,
+            k,
+            sysBoundaries,
+            RKCase
+         );
+      }
+      return;
+   }
+   
+   FsGridRowStencil< std::array<Real, fsgrids::bfield::N_BFIELD> > perBRows(perBGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::efield::N_EFIELD> > ERows(EGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::ehall::N_EHALL> > EHallRows(EHallGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::egradpe::N_EGRADPE> > EGradPeRows(EGradPeGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::moments::N_MOMENTS> > momentsRows(momentsGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::dperb::N_DPERB> > dPerBRows(dPerBGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::dmoments::N_DMOMENTS> > dMomentsRows(dMomentsGrid, j, k);
+   FsGridRowStencil< std::array<Real, fsgrids::bgbfield::N_BGB> > BgBRows(BgBGrid, j, k);
+   FsGridRowStencil< fsgrids::technical > technicalRows(technicalGrid, j, k);
+   
+   const uint components[3] = {compute::EX, compute::EY, compute::EZ};
+   for (int c=0; c<3; c++) {
+      cells[c].clear();
+   }
+   
+   for (int i=iStart; i<iEnd; i++) {
+      cuint cellSysBoundaryFlag = technicalRows.get(i,j,k)->sysBoundaryFlag;
+      
+      if (cellSysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
+      
+      cuint bitfield = technicalRows.get(i,j,k)->SOLVE;
+      
+      for (int c=0; c<3; c++) {
+         if ((bitfield & components[c]) == components[c]) {
+            cells[c].push_back(i);
+         } else {
+            sysBoundaries.getSysBoundary(cellSysBoundaryFlag)->fieldSolverBoundaryCondElectricField(EGrid, i, j, k, c);
+         }
+      }
+   }
+   
+   const int* cellsX = cells[0].data();
+   cint nCellsX = cells[0].size();
+   for (int n=0; n<nCellsX; n++) {
+      calculateEdgeElectricFieldX<FsGridRowStencil>(
+         perBRows,
+         ERows,
+         EHallRows,
+         EGradPeRows,
+         momentsRows,
+         dPerBRows,
+         dMomentsRows,
+         BgBRows,
+         technicalRows,
+         cellsX[n],
+         j,
+         k,
+         RKCase
+      );
+   }
+   
+   const int* cellsY = cells[1].data();
+   cint nCellsY = cells[1].size();
+   for (int n=0; n<nCellsY; n++) {
+      calculateEdgeElectricFieldY<FsGridRowStencil>(
+         perBRows,
+         ERows,
+         EHallRows,
+         EGradPeRows,
+         momentsRows,
+         dPerBRows,
+         dMomentsRows,
+         BgBRows,
+         technicalRows,
+         cellsY[n],
+         j,
+         k,
+         RKCase
+      );
+   }
+   
+   const int* cellsZ = cells[2].data();
+   cint nCellsZ = cells[2].size();
+   for (int n=0; n<nCellsZ; n++) {
+      calculateEdgeElectricFieldZ<FsGridRowStencil>(
+         perBRows,
+         ERows,
+         EHallRows,
+         EGradPeRows,
+         momentsRows,
+         dPerBRows,
+         dMomentsRows,
+         BgBRows,
+         technicalRows,
+         cellsZ[n],
+         j,
+         k,
+         RKCase
+      );
+   }
+}
+
 /*! \brief High-level electric field computation function.
  * 
  * Transfers the derivatives, calculates the edge electric fields and transfers the new electric fields.
  * 
+ * If the Hall term is used, it is computed in the same pass as the electric field. The local domain is cut
+ * into slabs of rows along y or z, one slab per thread, and each thread computes the Hall term of a row just
+ * before the electric field of that row, while the fields and derivatives are still in cache. Only the Hall term
+ * of the cells the others depend on is computed beforehand: those on the upper faces of the domain, which
+ * the neighbours receive in the ghost update, and those on the last row of each slab, where the next slab starts.
+ * 
  * \param perBGrid fsGrid holding the perturbed B quantities at runge-kutta t=0
  * \param perBDt2Grid fsGrid holding the perturbed B quantities at runge-kutta t=0.5
  * \param EGrid fsGrid holding the Electric field quantities at runge-kutta t=0
@@ -1612,8 +1831,9 @@ void calculateElectricField(
  * \param technicalGrid fsGrid holding technical information (such as boundary types)
  * \param sysBoundaries System boundary conditions existing
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
+ * \param communicateMomentsDerivatives whether to communicate the derivatives of moments for the Hall term
  * 
- * \sa calculateElectricField calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
+ * \sa calculateElectricFieldRow calculateHallTerm calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
  */
 void calculateUpwindedElectricFieldSimple(
    FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perBGrid,
@@ -1629,7 +1849,8 @@ void calculateUpwindedElectricFieldSimple(
    FsGrid< std::array<Real, fsgrids::bgbfield::N_BGB>, 2> & BgBGrid,
    FsGrid< fsgrids::technical, 2> & technicalGrid,
    SysBoundary& sysBoundaries,
-   cint& RKCase
+   cint& RKCase,
+   const bool communicateMomentsDerivatives
 ) {
    int timer;
    //const std::array<int, 3> gridDims = technicalGrid.getLocalSize();
@@ -1637,75 +1858,228 @@ void calculateUpwindedElectricFieldSimple(
    const size_t N_cells = gridDims[0]*gridDims[1]*gridDims[2];
    phiprof::start("Calculate upwinded electric field");
    
-   timer=phiprof::initializeTimer("MPI","MPI");
-   phiprof::start(timer);
-   if(P::ohmHallTerm > 0) {
-      EHallGrid.updateGhostCells();
-   }
-   if(P::ohmGradPeTerm > 0) {
-      EGradPeGrid.updateGhostCells();
-   }
-   if(P::ohmHallTerm == 0 && P::ohmGradPeTerm == 0) {
-      dPerBGrid.updateGhostCells();
-      dMomentsGrid.updateGhostCells();
-   }
-   phiprof::stop(timer);
+   // RK_ORDER2_STEP1 works on the half step quantities
+   const bool useDt2 = (RKCase == RK_ORDER2_STEP1);
+   FsGrid< std::array<Real, fsgrids::bfield::N_BFIELD>, 2> & perB = useDt2 ? perBDt2Grid : perBGrid;
+   FsGrid< std::array<Real, fsgrids::efield::N_EFIELD>, 2> & E = useDt2 ? EDt2Grid : EGrid;
+   FsGrid< std::array<Real, fsgrids::moments::N_MOMENTS>, 2> & moments = useDt2 ? momentsDt2Grid : momentsGrid;
    
-   // Calculate upwinded electric field on inner cells
-   timer=phiprof::initializeTimer("Compute cells");
-   phiprof::start(timer);
-   #pragma omp parallel for collapse(3)
-   for (int k=0; k<gridDims[2]; k++) {
-      for (int j=0; j<gridDims[1]; j++) {
-         for (int i=0; i<gridDims[0]; i++) {
-            if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
-               calculateElectricField(
-                  perBGrid,
-                  EGrid,
-                  EHallGrid,
-                  EGradPeGrid,
-                  momentsGrid,
-                  dPerBGrid,
-                  dMomentsGrid,
-                  BgBGrid,
-                  technicalGrid,
-                  i,
-                  j,
-                  k,
-                  sysBoundaries,
-                  RKCase
-               );
-            } else { // RKCase == RK_ORDER2_STEP1
-               calculateElectricField(
-                  perBDt2Grid,
-                  EDt2Grid,
+   if (P::ohmHallTerm > 0) {
+      timer=phiprof::initializeTimer("MPI","MPI");
+      phiprof::start(timer);
+      dPerBGrid.updateGhostCells();
+      if(communicateMomentsDerivatives) {
+         dMomentsGrid.updateGhostCells();
+      }
+      phiprof::stop(timer);
+      
+      // Slabs are cut along the longer of the y and z dimensions, the rows in a slab are
+      // indexed by (t,u) with t along the slab dimension and u along the other one.
+      const bool slabsAlongZ = (gridDims[2] >= gridDims[1]);
+      cint nSlabRows = slabsAlongZ ? gridDims[2] : gridDims[1];
+      cint nInnerRows = slabsAlongZ ? gridDims[1] : gridDims[2];
+      #ifdef _OPENMP
+      cint nSlabs = min(omp_get_max_threads(), nSlabRows);
+      #else
+      cint nSlabs = 1;
+      #endif
+      std::vector<int> slabStart(nSlabs+1);
+      for (int s=0; s<=nSlabs; s++) {
+         slabStart[s] = s*nSlabRows/nSlabs;
+      }
+      
+      // Dimensions with a single cell have no ghost cells and no neighbours depending on the upper face
+      const std::array<int32_t, 3> globalDims = technicalGrid.getGlobalSize();
+      const bool innerFace = (globalDims[slabsAlongZ ? 1 : 2] > 1);
+      cint xFaceStart = (globalDims[0] > 1) ? gridDims[0]-1 : gridDims[0];
+      std::vector<bool> fullRow(nSlabRows, false);
+      for (int s=1; s<nSlabs; s++) {
+         fullRow[slabStart[s]-1] = true;
+      }
+      if (globalDims[slabsAlongZ ? 2 : 1] > 1) {
+         fullRow[nSlabRows-1] = true;
+      }
+      
+      timer=phiprof::initializeTimer("Compute Hall term on faces");
+      phiprof::start(timer);
+      #pragma omp parallel for collapse(2)
+      for (int t=0; t<nSlabRows; t++) {
+         for (int u=0; u<nInnerRows; u++) {
+            cint j = slabsAlongZ ? u : t;
+            cint k = slabsAlongZ ? t : u;
+            cint iStart = (fullRow[t] || (innerFace && u == nInnerRows-1)) ? 0 : xFaceStart;
+            for (int i=iStart; i<gridDims[0]; i++) {
+               calculateHallTerm(perB, EHallGrid, moments, dPerBGrid, dMomentsGrid, BgBGrid, technicalGrid, sysBoundaries, i, j, k);
+            }
+         }
+      }
+      phiprof::stop(timer);
+      
+      timer=phiprof::initializeTimer("MPI","MPI");
+      phiprof::start(timer);
+      EHallGrid.updateGhostCells();
+      if(P::ohmGradPeTerm > 0) {
+         EGradPeGrid.updateGhostCells();
+      }
+      phiprof::stop(timer);
+      
+      timer=phiprof::initializeTimer("Compute cells");
+      phiprof::start(timer);
+      #pragma omp parallel
+      {
+         std::array<std::vector<int>, 3> cells;
+         #pragma omp for schedule(static,1)
+         for (int s=0; s<nSlabs; s++) {
+            for (int t=slabStart[s]; t<slabStart[s+1]; t++) {
+               for (int u=0; u<nInnerRows; u++) {
+                  cint j = slabsAlongZ ? u : t;
+                  cint k = slabsAlongZ ? t : u;
+                  cint iEnd = (fullRow[t] || (innerFace && u == nInnerRows-1)) ? 0 : xFaceStart;
+                  // The edge electric field of this row needs the Hall term of the previous rows in
+                  // both directions, which are done, and of the previous cell on this row.
+                  for (int i=0; i<iEnd; i++) {
+                     calculateHallTerm(perB, EHallGrid, moments, dPerBGrid, dMomentsGrid, BgBGrid, technicalGrid, sysBoundaries, i, j, k);
+                  }
+                  calculateElectricFieldRow(
+                     perB,
+                     E,
+                     EHallGrid,
+                     EGradPeGrid,
+                     moments,
+                     dPerBGrid,
+                     dMomentsGrid,
+                     BgBGrid,
+                     technicalGrid,
+                     j,
+                     k,
+                     0,
+                     gridDims[0],
+                     cells,
+                     sysBoundaries,
+                     RKCase
+                  );
+               }
+            }
+         }
+      }
+      phiprof::stop(timer,N_cells,"Spatial Cells");
+   } else {
+      // The edge electric fields only use cells at or below the current one, so the inner cells
+      // can be computed while the master thread updates the ghost cells of the derivatives.
+      const int mpiTimer=phiprof::initializeTimer("MPI","MPI");
+      timer=phiprof::initializeTimer("Compute cells");
+      phiprof::start(timer);
+      const InnerCells inner(technicalGrid);
+      #pragma omp parallel
+      {
+         #pragma omp master
+         {
+            phiprof::start(mpiTimer);
+            if(P::ohmGradPeTerm > 0) {
+               EGradPeGrid.updateGhostCells();
+            } else {
+               dPerBGrid.updateGhostCells();
+               dMomentsGrid.updateGhostCells();
+            }
+            phiprof::stop(mpiTimer);
+         }
+         
+         std::array<std::vector<int>, 3> cells;
+         #pragma omp for collapse(2) schedule(dynamic,1)
+         for (int k=inner.start[2]; k<inner.end[2]; k++) {
+            for (int j=inner.start[1]; j<inner.end[1]; j++) {
+               calculateElectricFieldRow(
+                  perB,
+                  E,
                   EHallGrid,
                   EGradPeGrid,
-                  momentsDt2Grid,
+                  moments,
                   dPerBGrid,
                   dMomentsGrid,
                   BgBGrid,
                   technicalGrid,
-                  i,
                   j,
                   k,
+                  inner.start[0],
+                  inner.end[0],
+                  cells,
                   sysBoundaries,
                   RKCase
                );
             }
          }
+         
+         // The boundary shell, after the ghost update
+         #pragma omp for collapse(2)
+         for (int k=0; k<gridDims[2]; k++) {
+            for (int j=0; j<gridDims[1]; j++) {
+               if (inner.isInnerRow(j,k)) {
+                  calculateElectricFieldRow(
+                     perB,
+                     E,
+                     EHallGrid,
+                     EGradPeGrid,
+                     moments,
+                     dPerBGrid,
+                     dMomentsGrid,
+                     BgBGrid,
+                     technicalGrid,
+                     j,
+                     k,
+                     0,
+                     inner.start[0],
+                     cells,
+                     sysBoundaries,
+                     RKCase
+                  );
+                  calculateElectricFieldRow(
+                     perB,
+                     E,
+                     EHallGrid,
+                     EGradPeGrid,
+                     moments,
+                     dPerBGrid,
+                     dMomentsGrid,
+                     BgBGrid,
+                     technicalGrid,
+                     j,
+                     k,
+                     inner.end[0],
+                     gridDims[0],
+                     cells,
+                     sysBoundaries,
+                     RKCase
+                  );
+               } else {
+                  calculateElectricFieldRow(
+                     perB,
+                     E,
+                     EHallGrid,
+                     EGradPeGrid,
+                     moments,
+                     dPerBGrid,
+                     dMomentsGrid,
+                     BgBGrid,
+                     technicalGrid,
+                     j,
+                     k,
+                     0,
+                     gridDims[0],
+                     cells,
+                     sysBoundaries,
+                     RKCase
+                  );
+               }
+            }
+         }
       }
+      phiprof::stop(timer,N_cells,"Spatial Cells");
    }
-   phiprof::stop(timer,N_cells,"Spatial Cells");
    
    timer=phiprof::initializeTimer("MPI","MPI");
    phiprof::start(timer);
    // Exchange electric field with neighbouring processes
-   if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
-      EGrid.updateGhostCells();
-   } else { 
-      EDt2Grid.updateGhostCells();
-   }
+   E.updateGhostCells();
    phiprof::stop(timer);
    
    phiprof::stop("Calculate upwinded electric field",N_cells,"Spatial Cells");
@@ -124,27 +124,10 @@ bool propagateFields(
    if (subcycles == 1) {
       #ifdef FS_1ST_ORDER_TIME
       propagateMagneticFieldSimple(perBGrid, perBDt2Grid, EGrid, EDt2Grid, technicalGrid, sysBoundaries, dt, RK_ORDER1);
-      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER1, true);
-      if(P::ohmGradPeTerm > 0){
-         calculateGradPeTermSimple(EGradPeGrid, momentsGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER1);
+      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER1, true, EGradPeGrid, P::ohmGradPeTerm > 0);
+      if(P::ohmGradPeTerm > 0) {
          hallTermCommunicateDerivatives = false;
       }
-      if(P::ohmHallTerm > 0) {
-         calculateHallTermSimple(
-            perBGrid,
-            perBDt2Grid,
-            EHallGrid,
-            momentsGrid,
-            momentsDt2Grid,
-            dPerBGrid,
-            dMomentsGrid,
-            BgBGrid,
-            technicalGrid,
-            sysBoundaries,
-            RK_ORDER1,
-            hallTermCommunicateDerivatives
-         );
-      }
       calculateUpwindedElectricFieldSimple(
          perBGrid,
          perBDt2Grid,
@@ -159,31 +142,15 @@ bool propagateFields(
          BgBGrid,
          technicalGrid,
          sysBoundaries,
-         RK_ORDER1
+         RK_ORDER1,
+         hallTermCommunicateDerivatives
       );
       #else
       propagateMagneticFieldSimple(perBGrid, perBDt2Grid, EGrid, EDt2Grid, technicalGrid, sysBoundaries, dt, RK_ORDER2_STEP1);
-      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1, true);
+      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1, true, EGradPeGrid, P::ohmGradPeTerm > 0);
       if(P::ohmGradPeTerm > 0) {
-         calculateGradPeTermSimple(EGradPeGrid, momentsGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1);
          hallTermCommunicateDerivatives = false;
       }
-      if(P::ohmHallTerm > 0) {
-         calculateHallTermSimple(
-            perBGrid,
-            perBDt2Grid,
-            EHallGrid,
-            momentsGrid,
-            momentsDt2Grid,
-            dPerBGrid,
-            dMomentsGrid,
-            BgBGrid,
-            technicalGrid,
-            sysBoundaries,
-            RK_ORDER2_STEP1,
-            hallTermCommunicateDerivatives
-         );
-      }
       calculateUpwindedElectricFieldSimple(
          perBGrid,
          perBDt2Grid,
@@ -198,31 +165,15 @@ bool propagateFields(
          BgBGrid,
          technicalGrid,
          sysBoundaries,
-         RK_ORDER2_STEP1
+         RK_ORDER2_STEP1,
+         hallTermCommunicateDerivatives
       );
       
       propagateMagneticFieldSimple(perBGrid, perBDt2Grid, EGrid, EDt2Grid, technicalGrid, sysBoundaries, dt, RK_ORDER2_STEP2);
-      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2, true);
+      calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2, true, EGradPeGrid, P::ohmGradPeTerm > 0);
       if(P::ohmGradPeTerm > 0) {
-         calculateGradPeTermSimple(EGradPeGrid, momentsGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2);
          hallTermCommunicateDerivatives = false;
       }
-      if(P::ohmHallTerm > 0) {
-         calculateHallTermSimple(
-            perBGrid,
-            perBDt2Grid,
-            EHallGrid,
-            momentsGrid,
-            momentsDt2Grid,
-            dPerBGrid,
-            dMomentsGrid,
-            BgBGrid,
-            technicalGrid,
-            sysBoundaries,
-            RK_ORDER2_STEP2,
-            hallTermCommunicateDerivatives
-         );
-      }
       calculateUpwindedElectricFieldSimple(
          perBGrid,
          perBDt2Grid,
@@ -237,7 +188,8 @@ bool propagateFields(
          BgBGrid,
          technicalGrid,
          sysBoundaries,
-         RK_ORDER2_STEP2
+         RK_ORDER2_STEP2,
+         hallTermCommunicateDerivatives
       );
       #endif
    } else {
@@ -255,27 +207,10 @@ bool propagateFields(
          
          // We need to calculate derivatives of the moments at every substep, but they only
          // need to be communicated in the first one.
-         calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1, (subcycleCount==0));
+         calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1, (subcycleCount==0), EGradPeGrid, P::ohmGradPeTerm > 0 && subcycleCount==0);
          if(P::ohmGradPeTerm > 0 && subcycleCount==0) {
-            calculateGradPeTermSimple(EGradPeGrid, momentsGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP1);
             hallTermCommunicateDerivatives = false;
          }
-         if(P::ohmHallTerm > 0) {
-            calculateHallTermSimple(
-               perBGrid,
-               perBDt2Grid,
-               EHallGrid,
-               momentsGrid,
-               momentsDt2Grid,
-               dPerBGrid,
-               dMomentsGrid,
-               BgBGrid,
-               technicalGrid,
-               sysBoundaries,
-               RK_ORDER2_STEP1,
-               hallTermCommunicateDerivatives
-            );
-         }
          calculateUpwindedElectricFieldSimple(
             perBGrid,
             perBDt2Grid,
@@ -290,34 +225,18 @@ bool propagateFields(
             BgBGrid,
             technicalGrid,
             sysBoundaries,
-            RK_ORDER2_STEP1
+            RK_ORDER2_STEP1,
+            hallTermCommunicateDerivatives
          );
          
          propagateMagneticFieldSimple(perBGrid, perBDt2Grid, EGrid, EDt2Grid, technicalGrid, sysBoundaries, subcycleDt, RK_ORDER2_STEP2);
          
          // We need to calculate derivatives of the moments at every substep, but they only
          // need to be communicated in the first one.
-         calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2, (subcycleCount==0));
+         calculateDerivativesSimple(perBGrid, perBDt2Grid, momentsGrid, momentsDt2Grid, dPerBGrid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2, (subcycleCount==0), EGradPeGrid, P::ohmGradPeTerm > 0 && subcycleCount==0);
          if(P::ohmGradPeTerm > 0 && subcycleCount==0) {
-            calculateGradPeTermSimple(EGradPeGrid, momentsGrid, momentsDt2Grid, dMomentsGrid, technicalGrid, sysBoundaries, RK_ORDER2_STEP2);
             hallTermCommunicateDerivatives = false;
          }
-         if(P::ohmHallTerm > 0) {
-            calculateHallTermSimple(
-               perBGrid,
-               perBDt2Grid,
-               EHallGrid,
-               momentsGrid,
-               momentsDt2Grid,
-               dPerBGrid,
-               dMomentsGrid,
-               BgBGrid,
-               technicalGrid,
-               sysBoundaries,
-               RK_ORDER2_STEP2,
-               hallTermCommunicateDerivatives
-            );
-         }
          calculateUpwindedElectricFieldSimple(
             perBGrid,
             perBDt2Grid,
@@ -332,7 +251,8 @@ bool propagateFields(
             BgBGrid,
             technicalGrid,
             sysBoundaries,
-            RK_ORDER2_STEP2
+            RK_ORDER2_STEP2,
+            hallTermCommunicateDerivatives
          );
          
          phiprof::start("FS subcycle stuff");
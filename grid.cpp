@@ -42,6 +42,7 @@
 #include "iowrite.h"
 #include "ioread.h"
 #include "object_wrapper.h"
+#include "memoryallocation.h"
 
 #ifdef PAPI_MEM
 #include "papi.h" 
@@ -244,7 +245,7 @@ void initializeGrids(
          #endif
 
             // set initial LB metric based on number of blocks, all others
-         // will be based on time spent in acceleration
+         // will be based on the measured time, see balanceLoad
          for (size_t i=0; i<cells.size(); ++i) {
             mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] += mpiGrid[cells[i]]->get_number_of_velocity_blocks(popID);
          }
@@ -398,31 +399,163 @@ void setFaceNeighborRanks( dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    }
 }
 
+/*! Number of rounds in which balanceLoad migrates the cells. The rounds are sized so that the data a
+ * process receives in one round fits in its share of the free memory of its node: few rounds when
+ * there is plenty of memory, more when some process is close to running out of it.
+ * Collective operation on MPI_COMM_WORLD.
+ * \param incoming_cells_list Cells this process receives
+ * \param outgoing_cells_list Cells this process sends
+ */
+uint64_t getNumberOfMigrationRounds(
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   const std::vector<CellID>& incoming_cells_list,
+   const std::vector<CellID>& outgoing_cells_list
+) {
+   // Fraction of the free memory of a process that one round may fill
+   const double memoryFraction = 0.5;
+   // Used if the free memory of the node cannot be read
+   const uint64_t defaultRounds = 5;
+   
+   // The sizes of the incoming cells are only known after their block lists have been
+   // transferred, so they are estimated by the average size of all migrated cells.
+   double local[2] = {0.0, (double)outgoing_cells_list.size()};
+   double global[2];
+   for (size_t i=0; i<outgoing_cells_list.size(); i++) {
+      local[0] += mpiGrid[outgoing_cells_list[i]]->get_cell_memory_size();
+   }
+   MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+   const double bytesPerCell = global[1] > 0.0 ? global[0] / global[1] : 0.0;
+   const double incomingBytes = incoming_cells_list.size() * bytesPerCell;
+   
+   // The free memory of the node is shared by all processes on it
+   static int processesOnNode = 0;
+   if (processesOnNode == 0) {
+      MPI_Comm nodeComm;
+      MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+      MPI_Comm_size(nodeComm, &processesOnNode);
+      MPI_Comm_free(&nodeComm);
+   }
+   const double budget = memoryFraction * get_node_free_memory() / processesOnNode;
+   
+   // The rounds are interleaved by cell ID, so more rounds than received cells do not help
+   uint64_t localRounds[2];
+   if (budget > 0.0) {
+      localRounds[0] = max((uint64_t)1, (uint64_t)ceil(incomingBytes / budget));
+   } else {
+      localRounds[0] = defaultRounds;
+   }
+   localRounds[1] = max((size_t)1, incoming_cells_list.size());
+   uint64_t globalRounds[2];
+   MPI_Allreduce(localRounds, globalRounds, 2, MPI_Type<uint64_t>(), MPI_MAX, MPI_COMM_WORLD);
+   return min(globalRounds[0], globalRounds[1]);
+}
+
+/*! Find the remote copies this process kept over a load balance and tell their owners about them, so that
+ * updateRemoteVelocityBlockLists only transfers the velocity block lists of the new copies. A copy is kept if
+ * it is still a remote neighbor after the balance and it has the same number of blocks as before.
+ * The result is given to SpatialCell::set_valid_remote_copies. Collective operation on MPI_COMM_WORLD.
+ * \param oldRemoteBlocks Number of blocks per population of the remote copies before the balance
+ */
+void setValidRemoteCopies(
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   const std::unordered_map<CellID, std::vector<vmesh::LocalID> >& oldRemoteBlocks
+) {
+   int nProcesses;
+   MPI_Comm_size(MPI_COMM_WORLD, &nProcesses);
+   
+   std::set<std::pair<CellID,int> > validCopies;
+   std::vector<std::vector<CellID> > keptCopies(nProcesses);
+   const std::vector<CellID> remoteCells = mpiGrid.get_remote_cells_on_process_boundary(DIST_FUNC_NEIGHBORHOOD_ID);
+   for (size_t i=0; i<remoteCells.size(); i++) {
+      const CellID cellID = remoteCells[i];
+      const auto it = oldRemoteBlocks.find(cellID);
+      SpatialCell* cell = mpiGrid[cellID];
+      if (it == oldRemoteBlocks.end() || cell == NULL) continue;
+      
+      bool unchanged = true;
+      for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         if (cell->get_number_of_velocity_blocks(popID) != it->second[popID]) unchanged = false;
+      }
+      if (!unchanged) continue;
+      
+      const int owner = mpiGrid.get_process(cellID);
+      keptCopies[owner].push_back(cellID);
+      validCopies.insert(std::make_pair(cellID, owner));
+   }
+   
+   // The owners, which may have changed in the balance, learn which of their cells have valid copies where
+   std::vector<int> sendCounts(nProcesses), sendOffsets(nProcesses), receiveCounts(nProcesses), receiveOffsets(nProcesses);
+   std::vector<CellID> sendBuffer;
+   for (int p=0; p<nProcesses; p++) {
+      sendCounts[p] = keptCopies[p].size();
+      sendOffsets[p] = sendBuffer.size();
+      sendBuffer.insert(sendBuffer.end(), keptCopies[p].begin(), keptCopies[p].end());
+   }
+   MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+   int nReceived = 0;
+   for (int p=0; p<nProcesses; p++) {
+      receiveOffsets[p] = nReceived;
+      nReceived += receiveCounts[p];
+   }
+   std::vector<CellID> receiveBuffer(nReceived);
+   MPI_Alltoallv(sendBuffer.data(), sendCounts.data(), sendOffsets.data(), MPI_Type<CellID>(),
+                 receiveBuffer.data(), receiveCounts.data(), receiveOffsets.data(), MPI_Type<CellID>(), MPI_COMM_WORLD);
+   for (int p=0; p<nProcesses; p++) {
+      for (int i=receiveOffsets[p]; i<receiveOffsets[p]+receiveCounts[p]; i++) {
+         validCopies.insert(std::make_pair(receiveBuffer[i], p));
+      }
+   }
+   
+   SpatialCell::set_valid_remote_copies(validCopies);
+}
+
 void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, SysBoundary& sysBoundaries){
    // Invalidate cached cell lists
    Parameters::meshRepartitioned = true;
+   Parameters::meshRepartitionCount++;
 
    // tell other processes which velocity blocks exist in remote spatial cells
    phiprof::initializeTimer("Balancing load", "Load balance");
    phiprof::start("Balancing load");
 
-   phiprof::start("deallocate boundary data");
-   //deallocate blocks in remote cells to decrease memory load
-   deallocateRemoteCellBlocks(mpiGrid);
+   // Remote copies that are still needed after the balance keep their blocks, remember their
+   // sizes to find out which ones are unchanged
+   std::unordered_map<CellID, std::vector<vmesh::LocalID> > oldRemoteBlocks;
+   const std::vector<CellID> oldRemoteCells = mpiGrid.get_remote_cells_on_process_boundary(DIST_FUNC_NEIGHBORHOOD_ID);
+   for (size_t i=0; i<oldRemoteCells.size(); i++) {
+      SpatialCell* cell = mpiGrid[oldRemoteCells[i]];
+      if (cell == NULL) continue;
+      std::vector<vmesh::LocalID>& nBlocks = oldRemoteBlocks[oldRemoteCells[i]];
+      for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         nBlocks.push_back(cell->get_number_of_velocity_blocks(popID));
+      }
+   }
 
-   phiprof::stop("deallocate boundary data");
-   //set weights based on each cells LB weight counter
+   //set weights based on the number of blocks and each cells LB weight counter
    vector<CellID> cells = mpiGrid.get_cells();
+   //The counter holds the wall time measured in the acceleration, translation and
+   //Vlasov boundary conditions of the cell during the steps preceding the rebalance
+   //(P::prepareForRebalance), initially it is the number of blocks. The block count
+   //is the base of the weight, so that cells that were not timed (DO_NOT_COMPUTE,
+   //not accelerated on these steps) keep a weight. The measured time is scaled so
+   //that on average it adds P::loadBalanceTimeWeight times the block count:
+   //   weight = blocks + timeWeight * counter * (total blocks / total counter)
+   vector<Real> blocks(cells.size(), 0.0);
+   double localSums[2] = {0.0, 0.0};
+   double globalSums[2];
+   for (size_t i=0; i<cells.size(); ++i){
+      for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         blocks[i] += mpiGrid[cells[i]]->get_number_of_velocity_blocks(popID);
+      }
+      localSums[0] += blocks[i];
+      localSums[1] += mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER];
+   }
+   MPI_Allreduce(localSums, globalSums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+   const double counterScale = globalSums[1] > 0.0 ? P::loadBalanceTimeWeight * globalSums[0] / globalSums[1] : 0.0;
    for (size_t i=0; i<cells.size(); ++i){
-      //Set weight. If acceleration is enabled then we use the weight
-      //counter which is updated in acceleration, otherwise we just
-      //use the number of blocks.
-//      if (P::propagateVlasovAcceleration) 
-      mpiGrid.set_cell_weight(cells[i], mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER]);
-//      else
-//         mpiGrid.set_cell_weight(cells[i], mpiGrid[cells[i]]->get_number_of_all_velocity_blocks());
-      //reset counter
-      //mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] = 0.0;
+      const double weight = blocks[i] + counterScale * mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER];
+      //Even cells without blocks have some cost
+      mpiGrid.set_cell_weight(cells[i], max(weight, 1.0));
    }
    phiprof::start("dccrg.initialize_balance_load");
    mpiGrid.initialize_balance_load(true);
@@ -434,9 +567,28 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
    const std::unordered_set<CellID>& outgoing_cells = mpiGrid.get_cells_removed_by_balance_load();
    std::vector<CellID> outgoing_cells_list (outgoing_cells.begin(),outgoing_cells.end()); 
    
+   phiprof::start("deallocate boundary data");
+   //deallocate blocks in remote copies of the cells moving to this process to decrease memory load,
+   //the cells are received in full
+   for (size_t i=0; i<incoming_cells_list.size(); i++) {
+      if (oldRemoteBlocks.erase(incoming_cells_list[i]) == 0) continue;
+      SpatialCell* cell = mpiGrid[incoming_cells_list[i]];
+      if (cell != NULL) {
+         for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+            cell->clear(popID);
+         }
+      }
+   }
+   phiprof::stop("deallocate boundary data");
+   
    /*transfer cells in parts to preserve memory*/
    phiprof::start("Data transfers");
-   const uint64_t num_part_transfers=5;
+   const uint64_t num_part_transfers=getNumberOfMigrationRounds(mpiGrid, incoming_cells_list, outgoing_cells_list);
+   int myRank;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   if (myRank == MASTER_RANK) {
+      logFile << "(LB): Migrating cells in " << num_part_transfers << " rounds" << endl << writeVerbose;
+   }
    for (uint64_t transfer_part=0; transfer_part<num_part_transfers; transfer_part++) {
       //Set transfers on/off for the incoming cells in this transfer set and prepare for receive
       for (unsigned int i=0;i<incoming_cells_list.size();i++){
@@ -526,9 +678,13 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
    mpiGrid.update_copies_of_remote_neighbors(FULL_NEIGHBORHOOD_ID);
 
    phiprof::start("update block lists");
-   //new partition, re/initialize blocklists of remote cells.
+   //new partition, re/initialize blocklists of remote cells. Only the new
+   //copies are updated, the ones kept over the balance are up to date.
+   setValidRemoteCopies(mpiGrid, oldRemoteBlocks);
    for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID)
       updateRemoteVelocityBlockLists(mpiGrid,popID);
+   std::set<std::pair<CellID,int> > noValidCopies;
+   SpatialCell::set_valid_remote_copies(noValidCopies);
    phiprof::stop("update block lists");
 
    phiprof::start("update sysboundaries");
@@ -609,18 +765,20 @@ bool adjustVelocityBlocks(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& m
          }
          neighbor_ptrs.push_back(mpiGrid[neighbor_id]);
       }
+      // Sums are taken through const access, so that blocks shared with a template cell are not copied
+      const SpatialCell* constCell = cell;
       if (getObjectWrapper().particleSpecies[popID].sparse_conserve_mass) {
          for (size_t i=0; i<cell->get_number_of_velocity_blocks(popID)*WID3; ++i) {
-            density_pre_adjust += cell->get_data(popID)[i];
+            density_pre_adjust += constCell->get_data(popID)[i];
          }
       }
       cell->adjust_velocity_blocks(neighbor_ptrs,popID);
 
       if (getObjectWrapper().particleSpecies[popID].sparse_conserve_mass) {
          for (size_t i=0; i<cell->get_number_of_velocity_blocks(popID)*WID3; ++i) {
-            density_post_adjust += cell->get_data(popID)[i];
+            density_post_adjust += constCell->get_data(popID)[i];
          }
-         if (density_post_adjust != 0.0) {
+         if (density_post_adjust != 0.0 && density_post_adjust != density_pre_adjust) {
             for (size_t i=0; i<cell->get_number_of_velocity_blocks(popID)*WID3; ++i) {
                cell->get_data(popID)[i] *= density_pre_adjust/density_post_adjust;
             }
@@ -638,7 +796,8 @@ bool adjustVelocityBlocks(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& m
    return true;
 }
 
-/*! Shrink to fit velocity space data to save memory.
+/*! Shrink to fit velocity space data to save memory, and free the
+ * velocity block buffers pooled by the threads.
  * \param mpiGrid Spatial grid
  */
 void shrink_to_fit_grid_data(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
@@ -651,6 +810,10 @@ void shrink_to_fit_grid_data(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>
       else
          mpiGrid[remote_cells[i - cells.size()]]->shrink_to_fit();
    }
+
+   // Give the block buffers cached for reuse back to the system
+   #pragma omp parallel
+   vmesh::releaseBlockBufferPool();
 }
 
 /*! Estimates memory consumption and writes it into logfile. Collective operation on MPI_COMM_WORLD
@@ -772,6 +935,8 @@ void updateRemoteVelocityBlockLists(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
        }
        continue;
      }
+     // Copies kept over a load balance already have their blocks
+     if (SpatialCell::is_valid_remote_copy(cell_id, mpiGrid.get_process(cell_id))) continue;
      cell->prepare_to_receive_blocks(popID);
    } 
 
@@ -95,8 +95,8 @@ uint64_t get_node_free_memory(){
             mem_proc_free = (uint64_t)memory * 1024;
          }
       }
+      fclose( in_file );
    }
-   fclose( in_file );
    
    return mem_proc_free;
 }
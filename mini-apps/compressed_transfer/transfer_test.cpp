@@ -0,0 +1,174 @@
+/*
+  Round trip test of the compressed velocity block data transfers of the translation
+  stencil (Transfer::VEL_BLOCK_DATA_COMPRESSED, velocity_block_compression.h).
+
+  dccrg sends all cells that go from one process to another in one message, built from
+  the MPI datatypes of the cells (set_send_single_cells(false)). The receiver can only
+  place the packed data of each cell if it knows the packed lengths, so they are
+  transferred first (Transfer::VEL_BLOCK_DATA_COMPRESSED_SIZE). This test does the same
+  with plain MPI: each process sends its cells to both of its neighbours in a ring, in
+  one message per process pair and stage, and checks the unpacked blocks against the
+  original data. Cells have different numbers of blocks, including none, and the blocks
+  range from empty to full. Both the lossless packing and a cutoff are tested.
+
+  With --single-stage the lengths are not transferred and every cell gets a receive
+  buffer sized for incompressible data, which is how the transfer worked before. The
+  test is then expected to fail with more than one cell per process pair.
+
+  Usage: mpirun -np N transfer_test [cellsPerProcess] [--single-stage]
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <mpi.h>
+
+#include "../../velocity_block_compression.h"
+
+struct Cell {
+   std::vector<Realf> data;
+   std::vector<char> packed;
+   uint64_t packedSize;
+};
+
+/* Block data of a cell of the given process, the same on every process so that the
+   receivers can check what they got.*/
+std::vector<Realf> makeCellData(const int rank, const int cell) {
+   std::mt19937 rng(1000 * rank + cell);
+   const size_t nBlocks = cell % 5 == 0 ? 0 : std::uniform_int_distribution<int>(1, 300)(rng);
+   std::vector<Realf> data(nBlocks * WID3, 0.0);
+   std::uniform_real_distribution<double> uniform(0.0, 1.0);
+   for (size_t b=0; b<nBlocks; ++b) {
+      // Fraction of non-zero cells in the block, from empty to full
+      const double fill = uniform(rng) < 0.3 ? 0.0 : uniform(rng);
+      for (int i=0; i<WID3; ++i) {
+         if (uniform(rng) < fill) {
+            data[b*WID3 + i] = std::pow(10.0, -18.0 + 6.0 * uniform(rng)) * (uniform(rng) < 0.05 ? -1 : 1);
+         }
+      }
+   }
+   return data;
+}
+
+/* One message with the given pieces of memory, as dccrg builds it from the cell datatypes.*/
+MPI_Datatype makeMessageType(const std::vector<void*>& addresses, const std::vector<int>& lengths) {
+   std::vector<MPI_Aint> displacements(addresses.size());
+   for (size_t i=0; i<addresses.size(); ++i) {
+      MPI_Get_address(addresses[i], &displacements[i]);
+   }
+   MPI_Datatype type;
+   MPI_Type_create_hindexed(addresses.size(), lengths.data(), displacements.data(), MPI_BYTE, &type);
+   MPI_Type_commit(&type);
+   return type;
+}
+
+/* Send the given field of all local cells to both neighbours and receive the same field
+   of their cells, in one message per neighbour.*/
+template<typename Pieces> void exchange(std::vector<Cell>& local, std::vector<Cell> remote[2],
+                                        const int neighbours[2], const int tag, Pieces pieces) {
+   std::vector<MPI_Request> requests;
+   std::vector<MPI_Datatype> types;
+   for (int n=0; n<2; ++n) {
+      std::vector<void*> addresses;
+      std::vector<int> lengths;
+      for (auto& cell : remote[n]) pieces(cell, true, addresses, lengths);
+      types.push_back(makeMessageType(addresses, lengths));
+      requests.push_back(MPI_REQUEST_NULL);
+      MPI_Irecv(MPI_BOTTOM, 1, types.back(), neighbours[n], tag + 1 - n, MPI_COMM_WORLD, &requests.back());
+   }
+   for (int n=0; n<2; ++n) {
+      std::vector<void*> addresses;
+      std::vector<int> lengths;
+      for (auto& cell : local) pieces(cell, false, addresses, lengths);
+      types.push_back(makeMessageType(addresses, lengths));
+      requests.push_back(MPI_REQUEST_NULL);
+      MPI_Isend(MPI_BOTTOM, 1, types.back(), neighbours[n], tag + n, MPI_COMM_WORLD, &requests.back());
+   }
+   MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+   for (auto& type : types) MPI_Type_free(&type);
+}
+
+/* Pack, transfer and unpack, return the number of remote cells with wrong data.*/
+int runTest(const int rank, const int neighbours[2], const int nCells, const Realf cutoff, const bool singleStage) {
+   std::vector<Cell> local(nCells);
+   for (int c=0; c<nCells; ++c) {
+      local[c].data = makeCellData(rank, c);
+      vblock::compressBlockData(local[c].data.data(), local[c].data.size() / WID3, cutoff, local[c].packed);
+      local[c].packedSize = local[c].packed.size();
+   }
+
+   // Remote copies know their blocks, but not the packed lengths
+   std::vector<Cell> remote[2];
+   for (int n=0; n<2; ++n) {
+      remote[n].resize(nCells);
+      for (int c=0; c<nCells; ++c) {
+         remote[n][c].data.assign(makeCellData(neighbours[n], c).size(), -1.0);
+         remote[n][c].packedSize = 0;
+      }
+   }
+
+   if (!singleStage) {
+      exchange(local, remote, neighbours, 10,
+               [](Cell& cell, bool, std::vector<void*>& addresses, std::vector<int>& lengths) {
+                  addresses.push_back(&cell.packedSize);
+                  lengths.push_back(sizeof(uint64_t));
+               });
+   }
+   exchange(local, remote, neighbours, 20,
+            [singleStage](Cell& cell, bool receiving, std::vector<void*>& addresses, std::vector<int>& lengths) {
+               if (receiving) {
+                  cell.packed.resize(singleStage ? cell.data.size() / WID3 * (sizeof(uint64_t) + sizeof(Realf)*WID3)
+                                                 : cell.packedSize);
+               }
+               addresses.push_back(cell.packed.data());
+               lengths.push_back(cell.packed.size());
+            });
+
+   int errors = 0;
+   for (int n=0; n<2; ++n) {
+      for (int c=0; c<nCells; ++c) {
+         Cell& cell = remote[n][c];
+         const std::vector<Realf> expected = makeCellData(neighbours[n], c);
+         bool ok = vblock::decompressBlockData(cell.packed.data(), cell.packed.size(), cell.data.data(), cell.data.size() / WID3);
+         for (size_t i=0; ok && i<expected.size(); ++i) {
+            const Realf value = std::fabs(expected[i]) <= cutoff ? 0.0 : expected[i];
+            ok = std::memcmp(&value, &cell.data[i], sizeof(Realf)) == 0;
+         }
+         if (!ok) errors++;
+      }
+   }
+   return errors;
+}
+
+int main(int argc, char** argv) {
+   MPI_Init(&argc, &argv);
+   int rank, size;
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+   MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+   int nCells = 16;
+   bool singleStage = false;
+   for (int i=1; i<argc; ++i) {
+      if (std::strcmp(argv[i], "--single-stage") == 0) singleStage = true;
+      else nCells = std::atoi(argv[i]);
+   }
+   const int neighbours[2] = {(rank + size - 1) % size, (rank + 1) % size};
+
+   int failed = 0;
+   const Realf cutoffs[2] = {0.0, 1.0e-15};
+   for (const Realf cutoff : cutoffs) {
+      const int localErrors = runTest(rank, neighbours, nCells, cutoff, singleStage);
+      int errors;
+      MPI_Reduce(&localErrors, &errors, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+      if (rank == 0) {
+         std::cout << "cutoff " << cutoff << ": " << errors << " of " << 2 * size * nCells
+                   << " remote cells wrong" << std::endl;
+      }
+      failed += errors > 0;
+   }
+
+   MPI_Finalize();
+   return failed > 0;
+}
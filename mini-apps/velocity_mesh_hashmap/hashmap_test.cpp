@@ -0,0 +1,132 @@
+/*
+  Benchmark of the velocity block global ID -> local ID maps: std::unordered_map,
+  used by VelocityMesh before, against vmesh::HashMap (velocity_mesh_hashmap.h).
+
+  Each "cell" holds the blocks of a Maxwellian-like sphere in a gridLength^3 block
+  mesh, plus a one block wide halo as created by adjustVelocityBlocks. The access
+  patterns mimic the solvers:
+    insert   - building the mesh of a cell (push_back)
+    hit      - getLocalID of existing blocks in block order (acceleration, moments)
+    random   - getLocalID of existing blocks in random order (translation, union of blocks)
+    miss     - getLocalID of the 26 neighbors of each block, mostly non-existing (adjust)
+    erase    - removing the halo blocks again (adjust, pop)
+
+  Usage: hashmap_test [gridLength] [repetitions]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "../../velocity_mesh_hashmap.h"
+
+typedef uint32_t GID;
+typedef uint32_t LID;
+
+const GID INVALID_GID = 0xFFFFFFFF;
+
+/* Global IDs of the blocks within radius of the center of the mesh, and of the
+   blocks in a one block halo around them.*/
+void makeBlocks(const GID gridLength, const double radius, std::vector<GID>& core, std::vector<GID>& halo) {
+   const double c = 0.5 * gridLength;
+   for (GID k=0; k<gridLength; ++k) for (GID j=0; j<gridLength; ++j) for (GID i=0; i<gridLength; ++i) {
+      const double r = std::sqrt((i+0.5-c)*(i+0.5-c) + (j+0.5-c)*(j+0.5-c) + (k+0.5-c)*(k+0.5-c));
+      const GID gid = i + j*gridLength + k*gridLength*gridLength;
+      if (r < radius) core.push_back(gid);
+      else if (r < radius + 1.0) halo.push_back(gid);
+   }
+}
+
+template<typename Map>
+double run(const char* name, const GID gridLength, const std::vector<GID>& core, const std::vector<GID>& halo,
+           const std::vector<GID>& shuffled, const int repetitions) {
+   typedef std::chrono::high_resolution_clock Clock;
+   double tInsert = 0, tHit = 0, tRandom = 0, tMiss = 0, tErase = 0;
+   uint64_t checksum = 0;
+   const GID n = gridLength;
+
+   for (int rep=0; rep<repetitions; ++rep) {
+      Map map;
+
+      auto t0 = Clock::now();
+      LID lid = 0;
+      for (auto gid : core) map.insert(std::make_pair(gid, lid++));
+      for (auto gid : halo) map.insert(std::make_pair(gid, lid++));
+      auto t1 = Clock::now();
+
+      for (auto gid : core) {
+         auto it = map.find(gid);
+         if (it != map.end()) checksum += it->second;
+      }
+      auto t2 = Clock::now();
+
+      for (auto gid : shuffled) {
+         auto it = map.find(gid);
+         if (it != map.end()) checksum += it->second;
+      }
+      auto t3 = Clock::now();
+
+      for (auto gid : core) {
+         const int i = gid % n, j = (gid / n) % n, k = gid / (n*n);
+         for (int dk=-1; dk<2; ++dk) for (int dj=-1; dj<2; ++dj) for (int di=-1; di<2; ++di) {
+            if (di == 0 && dj == 0 && dk == 0) continue;
+            // Two halo widths out, so that most lookups miss
+            const GID nbr = (i+2*di) + (j+2*dj)*n + (k+2*dk)*n*n;
+            auto it = map.find(nbr);
+            if (it != map.end()) checksum += it->second;
+         }
+      }
+      auto t4 = Clock::now();
+
+      for (auto gid : halo) map.erase(map.find(gid));
+      auto t5 = Clock::now();
+      if (map.size() != core.size()) {
+         std::cerr << name << ": wrong size after erase, " << map.size() << " vs " << core.size() << std::endl;
+         exit(1);
+      }
+
+      tInsert += std::chrono::duration<double>(t1-t0).count();
+      tHit    += std::chrono::duration<double>(t2-t1).count();
+      tRandom += std::chrono::duration<double>(t3-t2).count();
+      tMiss   += std::chrono::duration<double>(t4-t3).count();
+      tErase  += std::chrono::duration<double>(t5-t4).count();
+   }
+
+   const double nsPerRep = 1.0e9 / repetitions;
+   std::cout << name
+             << "  insert " << tInsert*nsPerRep/(core.size()+halo.size()) << " ns"
+             << "  hit " << tHit*nsPerRep/core.size() << " ns"
+             << "  random " << tRandom*nsPerRep/shuffled.size() << " ns"
+             << "  miss " << tMiss*nsPerRep/(26*core.size()) << " ns"
+             << "  erase " << tErase*nsPerRep/halo.size() << " ns"
+             << "  (checksum " << checksum << ")" << std::endl;
+   return tInsert + tHit + tRandom + tMiss + tErase;
+}
+
+int main(int argc, char* argv[]) {
+   const GID gridLength = argc > 1 ? atoi(argv[1]) : 50;
+   const int repetitions = argc > 2 ? atoi(argv[2]) : 20;
+
+   // Sphere radii giving roughly 1e2 to 1e5 blocks per cell
+   const double radii[] = {3.0, 6.0, 12.0, 0.45 * gridLength};
+   for (auto radius : radii) {
+      if (radius > 0.5 * gridLength - 2) continue;
+      std::vector<GID> core, halo;
+      makeBlocks(gridLength, radius, core, halo);
+      std::vector<GID> shuffled(core);
+      std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(12345));
+
+      std::cout << "gridLength " << gridLength << ", " << core.size() << " blocks + "
+                << halo.size() << " halo blocks, " << repetitions << " repetitions" << std::endl;
+      const double tStd  = run<std::unordered_map<GID,LID>>("  std::unordered_map", gridLength, core, halo, shuffled, repetitions);
+      const double tFlat = run<vmesh::HashMap<GID,LID,INVALID_GID>>("  vmesh::HashMap    ", gridLength, core, halo, shuffled, repetitions);
+      std::cout << "  speedup " << tStd / tFlat << std::endl;
+   }
+   return 0;
+}
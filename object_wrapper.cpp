@@ -64,6 +64,7 @@ bool ObjectWrapper::addPopulationParameters() {
      RP::add(pop + "_vspace.vy_length","Initial number of velocity blocks in vy-direction.",1);
      RP::add(pop + "_vspace.vz_length","Initial number of velocity blocks in vz-direction.",1);
      RP::add(pop + "_vspace.max_refinement_level","Maximum allowed mesh refinement level.", 1);
+     RP::add(pop + "_vspace.dense_local_ids","Look up velocity block local IDs from an array indexed by global ID instead of a hash map. Costs 4 bytes per block of the full velocity mesh in every spatial cell, including remote copies, so only meshes of at most 32768 blocks can use it.", false);
      
      // Thermal / suprathermal parameters
      Readparameters::add(pop + "_thermal.vx", "Center coordinate for the maxwellian distribution. Used for calculating the suprathermal moments.", -500000.0);
@@ -159,6 +160,7 @@ bool ObjectWrapper::getParameters() {
       int maxRefLevel; // Temporary variable, since target value is a uint8_t
       RP::get(pop + "_vspace.max_refinement_level",maxRefLevel);
       vMesh.refLevelMaxAllowed = maxRefLevel;
+      RP::get(pop + "_vspace.dense_local_ids",vMesh.denseLocalIDs);
 
       
       //Get thermal / suprathermal moments parameters
@@ -74,6 +74,7 @@ uint P::diagnosticInterval = numeric_limits<uint>::max();
 bool P::writeInitialState = true;
 
 bool P::meshRepartitioned = true;
+uint P::meshRepartitionCount = 0;
 bool P::prepareForRebalance = false;
 std::vector<CellID> P::localCells;
 
@@ -105,8 +106,12 @@ bool P::dynamicTimestep = true;
 Real P::maxWaveVelocity = 0.0;
 uint P::maxFieldSolverSubcycles = 0.0;
 int P::maxSlAccelerationSubcycles = 0.0;
+bool P::pipelinedTranslation = false;
+bool P::compressedTranslationTransfers = false;
+Real P::compressedTransferCutoff = 0.0;
 Real P::resistivity = NAN;
 bool P::fieldSolverDiffusiveEterms = true;
+bool P::fieldSolverRowStencil = true;
 uint P::ohmHallTerm = 0;
 uint P::ohmGradPeTerm = 0;
 Real P::electronTemperature = 0.0;
@@ -117,6 +122,8 @@ int P::writeAsFloat = false;
 string P::loadBalanceAlgorithm = string("");
 string P::loadBalanceTolerance = string("");
 uint P::rebalanceInterval = numeric_limits<uint>::max();
+uint P::loadBalanceMeasuredSteps = 3;
+Real P::loadBalanceTimeWeight = 1.0;
 
 vector<string> P::outputVariableList;
 vector<string> P::diagnosticVariableList;
@@ -201,10 +208,14 @@ bool Parameters::addParameters(){
    Readparameters::add("fieldsolver.electronTemperature", "Constant electron temperature to be used for the electron pressure gradient term (K).", 0.0);
    Readparameters::add("fieldsolver.maxCFL","The maximum CFL limit for field propagation. Used to set timestep if dynamic_timestep is true.",0.5);
    Readparameters::add("fieldsolver.minCFL","The minimum CFL limit for field propagation. Used to set timestep if dynamic_timestep is true.",0.4);
+   Readparameters::add("fieldsolver.rowStencil","Compute the edge electric fields row by row along x without checking each grid access, false for the cell by cell computation",true);
 
    // Vlasov solver parameters
    Readparameters::add("vlasovsolver.maxSlAccelerationRotation","Maximum rotation angle (degrees) allowed by the Semi-Lagrangian solver (Use >25 values with care)",25.0);
    Readparameters::add("vlasovsolver.maxSlAccelerationSubcycles","Maximum number of subcycles for acceleration",1);
+   Readparameters::add("vlasovsolver.pipelinedTranslation","Translate process inner cells while the stencil data of process boundary cells is in transfer",false);
+   Readparameters::add("vlasovsolver.compressedTranslationTransfers","Compress the velocity block data of the translation stencil transfers",false);
+   Readparameters::add("vlasovsolver.compressedTransferCutoff","Values below this fraction of the sparsity threshold are sent as zeros in compressed translation transfers, 0 for lossless compression",0.0);
    Readparameters::add("vlasovsolver.maxCFL","The maximum CFL limit for vlasov propagation in ordinary space. Used to set timestep if dynamic_timestep is true.",0.99);
    Readparameters::add("vlasovsolver.minCFL","The minimum CFL limit for vlasov propagation in ordinary space. Used to set timestep if dynamic_timestep is true.",0.8);
 
@@ -212,6 +223,8 @@ bool Parameters::addParameters(){
    Readparameters::add("loadBalance.algorithm", "Load balancing algorithm to be used", string("RCB"));
    Readparameters::add("loadBalance.tolerance", "Load imbalance tolerance", string("1.05"));
    Readparameters::add("loadBalance.rebalanceInterval", "Load rebalance interval (steps)", 10);
+   Readparameters::add("loadBalance.measuredSteps", "Number of steps before each rebalance over which the computation time of the cells is measured (at most rebalanceInterval)", 3);
+   Readparameters::add("loadBalance.timeWeight", "Weight of the measured computation time in the cell weights, relative to the number of velocity blocks. With 1 both contribute equally on average, with 0 only the blocks are used.", 1.0);
    
 // Output variable parameters
    // NOTE Do not remove the : before the list of variable names as this is parsed by tools/check_vlasiator_cfg.sh
@@ -496,9 +509,13 @@ bool Parameters::getParameters(){
    Readparameters::get("fieldsolver.electronTemperature", P::electronTemperature);
    Readparameters::get("fieldsolver.maxCFL",P::fieldSolverMaxCFL);
    Readparameters::get("fieldsolver.minCFL",P::fieldSolverMinCFL);
+   Readparameters::get("fieldsolver.rowStencil",P::fieldSolverRowStencil);
    // Get Vlasov solver parameters
    Readparameters::get("vlasovsolver.maxSlAccelerationRotation",P::maxSlAccelerationRotation);
    Readparameters::get("vlasovsolver.maxSlAccelerationSubcycles",P::maxSlAccelerationSubcycles);
+   Readparameters::get("vlasovsolver.pipelinedTranslation",P::pipelinedTranslation);
+   Readparameters::get("vlasovsolver.compressedTranslationTransfers",P::compressedTranslationTransfers);
+   Readparameters::get("vlasovsolver.compressedTransferCutoff",P::compressedTransferCutoff);
    Readparameters::get("vlasovsolver.maxCFL",P::vlasovSolverMaxCFL);
    Readparameters::get("vlasovsolver.minCFL",P::vlasovSolverMinCFL);
 
@@ -507,6 +524,8 @@ bool Parameters::getParameters(){
    Readparameters::get("loadBalance.algorithm", P::loadBalanceAlgorithm);
    Readparameters::get("loadBalance.tolerance", P::loadBalanceTolerance);
    Readparameters::get("loadBalance.rebalanceInterval", P::rebalanceInterval);
+   Readparameters::get("loadBalance.measuredSteps", P::loadBalanceMeasuredSteps);
+   Readparameters::get("loadBalance.timeWeight", P::loadBalanceTimeWeight);
    
    // Get output variable parameters
    Readparameters::get("variables.output", P::outputVariableList);
@@ -64,6 +64,7 @@ struct Parameters {
    static uint tstep;               /*!< The number of the current timestep. 0=initial state. */
 
    static bool meshRepartitioned;         /*!< If true, mesh was repartitioned on this time step.*/
+   static uint meshRepartitionCount;      /*!< Number of times the mesh has been repartitioned, for invalidating cached data once.*/
    static std::vector<CellID> localCells; /*!< Cached copy of spatial cell IDs on this process.*/
 
    static uint diagnosticInterval;
@@ -102,9 +103,13 @@ struct Parameters {
    static uint ohmGradPeTerm; /*!< Enable/choose spatial order of the electron pressure gradient term in Ohm's law. 0: off, 1: 1st spatial order. */
    static Real electronTemperature; /*!< Constant electron temperature to be used for the electron pressure gradient term (K). */
    static bool fieldSolverDiffusiveEterms; /*!< Enable resistive terms in the computation of E*/
+   static bool fieldSolverRowStencil; /*!< If true, the edge electric fields are computed row by row without checking each grid access, otherwise cell by cell.*/
    
    static Real maxSlAccelerationRotation; /*!< Maximum rotation in acceleration for semilagrangian solver*/
    static int maxSlAccelerationSubcycles; /*!< Maximum number of subcycles in acceleration*/
+   static bool pipelinedTranslation; /*!< If true, translate process inner cells while the stencil data of process boundary cells is in transfer.*/
+   static bool compressedTranslationTransfers; /*!< If true, the velocity block data of the translation stencil is compressed for the transfer.*/
+   static Real compressedTransferCutoff; /*!< Values below this fraction of the sparsity threshold are sent as zeros in compressed transfers, 0 is lossless.*/
    
    static Real hallMinimumRhom;  /*!< Minimum mass density value used in the field solver.*/
    static Real hallMinimumRhoq;  /*!< Minimum charge density value used for the Hall and electron pressure gradient terms in the Lorentz force and in the field solver.*/
@@ -112,6 +117,8 @@ struct Parameters {
    static std::string loadBalanceAlgorithm; /*!< Algorithm to be used for load balance.*/
    static std::string loadBalanceTolerance; /*!< Load imbalance tolerance. */ 
    static uint rebalanceInterval; /*!< Load rebalance interval (steps). */
+   static uint loadBalanceMeasuredSteps; /*!< Number of steps before a rebalance over which the time of each cell is measured. */
+   static Real loadBalanceTimeWeight; /*!< Weight of the measured time relative to the number of blocks in the cell weights. */
    static bool prepareForRebalance; /**< If true, propagators should measure their time consumption in preparation
                                      * for mesh repartitioning.*/
 
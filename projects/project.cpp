@@ -292,15 +292,16 @@ namespace projects {
       creal dy = cell->parameters[CellParams::DY];
       creal dz = cell->parameters[CellParams::DZ];
 
-      const Real* parameters = cell->get_block_parameters(popID);
+      Real parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+      cell->get_block_info(blockLID,popID,parameters);
       Realf* data = cell->get_data(popID);
       
-      creal vxBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD];
-      creal vyBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD];
-      creal vzBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD];
-      creal dvxCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-      creal dvyCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-      creal dvzCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+      creal vxBlock = parameters[BlockParams::VXCRD];
+      creal vyBlock = parameters[BlockParams::VYCRD];
+      creal vzBlock = parameters[BlockParams::VZCRD];
+      creal dvxCell = parameters[BlockParams::DVX];
+      creal dvyCell = parameters[BlockParams::DVY];
+      creal dvzCell = parameters[BlockParams::DVZ];
       
       // Calculate volume average of distribution function for each phase-space cell in the block.
       Real maxValue = 0.0;
@@ -423,13 +424,13 @@ namespace projects {
       // Re-scale densities
       Real sum = 0.0;
       Realf* data = cell->get_data(popID);
-      const Real* blockParams = cell->get_block_parameters(popID);
+      Real blockParams[BlockParams::N_VELOCITY_BLOCK_PARAMS];
       for (vmesh::LocalID blockLID=0; blockLID<cell->get_number_of_velocity_blocks(popID); ++blockLID) {
          Real tmp = 0.0;
          for (unsigned int i=0; i<WID3; ++i) tmp += data[blockLID*WID3+i];
+         cell->get_block_info(blockLID,popID,blockParams);
          const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
          sum += tmp*DV3;
-         blockParams += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
       
       const Real correctSum = getCorrectNumberDensity(cell,popID);
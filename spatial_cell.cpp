@@ -25,6 +25,7 @@
 
 #include "spatial_cell.hpp"
 #include "velocity_blocks.h"
+#include "velocity_block_compression.h"
 #include "object_wrapper.h"
 
 #ifndef NDEBUG
@@ -37,6 +38,7 @@ namespace spatial_cell {
    int SpatialCell::activePopID = 0;
    uint64_t SpatialCell::mpi_transfer_type = 0;
    bool SpatialCell::mpiTransferAtSysBoundaries = false;
+   std::set<std::pair<CellID,int> > SpatialCell::validRemoteCopies;
 
    SpatialCell::SpatialCell() {
       // Block list and cache always have room for all blocks
@@ -60,6 +62,8 @@ namespace spatial_cell {
       
       //is transferred by default
       this->mpiTransferEnabled=true;
+      this->compressedBlockDataSize=0;
+      this->compressedBlockDataReceived=false;
       
       // Set correct number of populations
       populations.resize(getObjectWrapper().particleSpecies.size());
@@ -74,6 +78,8 @@ namespace spatial_cell {
    }
 
    SpatialCell::SpatialCell(const SpatialCell& other):
+     compressedBlockDataSize(0),
+     compressedBlockDataReceived(false),
      sysBoundaryFlag(other.sysBoundaryFlag),
      sysBoundaryLayer(other.sysBoundaryLayer),
      velocity_block_with_content_list(other.velocity_block_with_content_list),
@@ -186,7 +192,8 @@ namespace spatial_cell {
             if (removeBlock == true) {
                //No content, and also no neighbor have content -> remove
                //and increment rho loss counters
-               const Real* block_parameters = get_block_parameters(popID)+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+               Real block_parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+               get_block_info(blockLID,popID,block_parameters);
                const Real DV3 = block_parameters[BlockParams::DVX]
                  * block_parameters[BlockParams::DVY]
                  * block_parameters[BlockParams::DVZ];
@@ -204,6 +211,9 @@ namespace spatial_cell {
       for (std::unordered_set<vmesh::GlobalID>::iterator it=neighbors_have_content.begin(); it != neighbors_have_content.end(); ++it) {
          this->add_velocity_block(*it,popID);
       }
+
+      // Removed blocks do not shrink the velocity extent of the mesh, do it here (used by computeNewTimeStep)
+      populations[popID].vmesh.updateBlockIndexBounds();
    }
 
    #else       // AMR version
@@ -280,7 +290,8 @@ namespace spatial_cell {
             if (removeBlock == true) {
                //No content, and also no neighbor have content -> remove
                //and increment rho loss counters
-               const Real* block_parameters = get_block_parameters(popID)+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+               Real block_parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+               get_block_info(blockLID,popID,block_parameters);
                const Real DV3 = block_parameters[BlockParams::DVX]
                  * block_parameters[BlockParams::DVY]
                  * block_parameters[BlockParams::DVZ];
@@ -382,6 +393,42 @@ namespace spatial_cell {
       adjust_velocity_blocks(neighbor_ptrs,popID,false);
    }
 
+   /** Pack the velocity block data of the given species into compressedBlockData
+    * for Transfer::VEL_BLOCK_DATA_COMPRESSED, see vblock::compressBlockData. Values
+    * whose magnitude is not above cutoff are dropped and arrive as zeros, with cutoff 0
+    * the packing is lossless. The packed length is sent first with
+    * Transfer::VEL_BLOCK_DATA_COMPRESSED_SIZE. The data is packed into a per-thread buffer
+    * that fits incompressible data, so compressedBlockData only allocates the packed length.
+    * Free it with release_compressed_block_data once it has been sent.
+    * @param popID ID of the particle species.
+    * @param cutoff Largest absolute value that is sent as zero.*/
+   void SpatialCell::compress_block_data(const uint popID,const Realf cutoff) {
+      static thread_local std::vector<char> packBuffer;
+      const SpatialCell* constThis = this;
+      vblock::compressBlockData(constThis->get_data(popID),populations[popID].blockContainer.size(),cutoff,packBuffer);
+      compressedBlockData.assign(packBuffer.begin(),packBuffer.end());
+      compressedBlockDataSize = compressedBlockData.size();
+   }
+
+   /** Unpack the velocity block data received with Transfer::VEL_BLOCK_DATA_COMPRESSED
+    * into the blocks of the given species and free the received data. Does nothing if no
+    * data was received after the previous call.
+    * @param popID ID of the particle species.
+    * @return If false, the received data did not match the velocity blocks of this cell.*/
+   bool SpatialCell::decompress_block_data(const uint popID) {
+      if (!compressedBlockDataReceived) return true;
+      compressedBlockDataReceived = false;
+      const bool success = vblock::decompressBlockData(compressedBlockData.data(),compressedBlockData.size(),
+                                                       get_data(popID),populations[popID].blockContainer.size());
+      release_compressed_block_data();
+      return success;
+   }
+
+   /** Free the packed block data of compress_block_data or of a received transfer.*/
+   void SpatialCell::release_compressed_block_data() {
+      std::vector<char>().swap(compressedBlockData);
+   }
+
    void SpatialCell::coarsen_block(const vmesh::GlobalID& parent,const std::vector<vmesh::GlobalID>& children,const uint popID) {
       #ifdef DEBUG_SPATIAL_CELL
       if (popID >= populations.size()) {
@@ -592,8 +639,12 @@ namespace spatial_cell {
       // create datatype for actual data if we are in the first two 
       // layers around a boundary, or if we send for the whole system
       if (this->mpiTransferEnabled && (SpatialCell::mpiTransferAtSysBoundaries==false || this->sysBoundaryLayer ==1 || this->sysBoundaryLayer ==2 )) {
+         // Block lists that the other process already has are not transferred again
+         const bool validBlockList = !validRemoteCopies.empty() &&
+            is_valid_remote_copy(cellID, receiving ? sender_rank : receiver_rank);
+         
          //add data to send/recv to displacement and block length lists
-         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_LIST_STAGE1) != 0) {
+         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_LIST_STAGE1) != 0 && !validBlockList) {
             //first copy values in case this is the send operation
             populations[activePopID].N_blocks = populations[activePopID].blockContainer.size();
 
@@ -602,7 +653,7 @@ namespace spatial_cell {
             block_lengths.push_back(sizeof(vmesh::LocalID));
          }
 
-         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_LIST_STAGE2) != 0) {
+         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_LIST_STAGE2) != 0 && !validBlockList) {
             // STAGE1 should have been done, otherwise we have problems...
             if (receiving) {
                //mpi_number_of_blocks transferred earlier
@@ -634,10 +685,31 @@ namespace spatial_cell {
          }
 
          if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_DATA) !=0) {
-            displacements.push_back((uint8_t*) get_data(activePopID) - (uint8_t*) this);
+            // Senders only read, so blocks shared with a template cell are not copied for the send
+            const SpatialCell* constThis = this;
+            const uint8_t* data = receiving ? (uint8_t*) get_data(activePopID) : (const uint8_t*) constThis->get_data(activePopID);
+            displacements.push_back(data - (uint8_t*) this);
             block_lengths.push_back(sizeof(Realf) * VELOCITY_BLOCK_LENGTH * populations[activePopID].blockContainer.size());
          }
 
+         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_DATA_COMPRESSED_SIZE) !=0) {
+            // Set by compress_block_data on the sending side
+            displacements.push_back((uint8_t*) &(this->compressedBlockDataSize) - (uint8_t*) this);
+            block_lengths.push_back(sizeof(uint64_t));
+         }
+
+         if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_DATA_COMPRESSED) !=0) {
+            // The receive buffer has exactly the packed length received with
+            // VEL_BLOCK_DATA_COMPRESSED_SIZE. It has to be exact, as the cells sent to a
+            // process are packed into one message without their lengths.
+            if (receiving) {
+               compressedBlockData.resize(this->compressedBlockDataSize);
+               compressedBlockDataReceived = true;
+            }
+            displacements.push_back((uint8_t*) compressedBlockData.data() - (uint8_t*) this);
+            block_lengths.push_back(compressedBlockData.size());
+         }
+
          if ((SpatialCell::mpi_transfer_type & Transfer::NEIGHBOR_VEL_BLOCK_DATA) != 0) {
             /*We are actually transferring the data of a
             * neighbor. The values of neighbor_block_data
@@ -736,10 +808,12 @@ namespace spatial_cell {
             block_lengths.push_back(sizeof(uint));
          }
          
+         #ifndef DERIVED_BLOCK_PARAMETERS
          if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_PARAMETERS) !=0) {
             displacements.push_back((uint8_t*) get_block_parameters(activePopID) - (uint8_t*) this);
             block_lengths.push_back(sizeof(Real) * size(activePopID) * BlockParams::N_VELOCITY_BLOCK_PARAMS);
          }
+         #endif
          // Copy particle species metadata
          if ((SpatialCell::mpi_transfer_type & Transfer::POP_METADATA) != 0) {
             for (uint popID=0; popID<populations.size(); ++popID) {
@@ -1263,6 +1337,7 @@ namespace spatial_cell {
       populations[popID].vmesh.setGrid();
       populations[popID].blockContainer.setSize(populations[popID].vmesh.size());
 
+      #ifndef DERIVED_BLOCK_PARAMETERS
       Real* parameters = get_block_parameters(popID);
       
       // Set velocity block parameters:
@@ -1274,6 +1349,7 @@ namespace spatial_cell {
          populations[popID].vmesh.getCellSize(blockGID,&(parameters[BlockParams::DVX]));
          parameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
+      #endif
    }
 
    void SpatialCell::refine_block(const vmesh::GlobalID& blockGID,std::map<vmesh::GlobalID,vmesh::LocalID>& insertedBlocks,const uint popID) {
@@ -1305,9 +1381,11 @@ namespace spatial_cell {
             
             
             // Set refined block parameters
+            #ifndef DERIVED_BLOCK_PARAMETERS
             Real* blockParams = populations[popID].blockContainer.getParameters(ins->second);
             populations[popID].vmesh.getBlockCoordinates(ins->first,blockParams);
             populations[popID].vmesh.getCellSize(ins->first,blockParams+3);
+            #endif
             
             ++ins;
          }
@@ -1315,9 +1393,11 @@ namespace spatial_cell {
       
       for (std::map<vmesh::GlobalID,vmesh::LocalID>::iterator it=newInserted.begin(); it!=newInserted.end(); ++it) {
          // Set refined block parameters
+         #ifndef DERIVED_BLOCK_PARAMETERS
          Real* blockParams = populations[popID].blockContainer.getParameters(it->second);
          populations[popID].vmesh.getBlockCoordinates(it->first,blockParams);
          populations[popID].vmesh.getCellSize(it->first,blockParams+3);
+         #endif
          
       }
 
@@ -50,6 +50,9 @@ Spatial cell class for Vlasiator that supports a variable number of velocity blo
    #include "velocity_mesh_old.h"
 #else
    #include "velocity_mesh_amr.h"
+   #ifdef DERIVED_BLOCK_PARAMETERS
+      #error "DERIVED_BLOCK_PARAMETERS is not supported by the AMR velocity space solvers"
+   #endif
 #endif
 
 #include "amr_refinement_criteria.h"
@@ -94,6 +97,7 @@ namespace spatial_cell {
       const uint64_t VEL_BLOCK_LIST_STAGE1    = (1ull<<2);
       const uint64_t VEL_BLOCK_LIST_STAGE2    = (1ull<<3);
       const uint64_t VEL_BLOCK_DATA           = (1ull<<4);
+      const uint64_t VEL_BLOCK_DATA_COMPRESSED = (1ull<<5); /**< Block data packed by compress_block_data, after VEL_BLOCK_DATA_COMPRESSED_SIZE.*/
       const uint64_t VEL_BLOCK_PARAMETERS     = (1ull<<6);
       const uint64_t VEL_BLOCK_WITH_CONTENT_STAGE1  = (1ull<<7); 
       const uint64_t VEL_BLOCK_WITH_CONTENT_STAGE2  = (1ull<<8); 
@@ -117,6 +121,7 @@ namespace spatial_cell {
       const uint64_t POP_METADATA             = (1ull<<26);
       const uint64_t RANDOMGEN                = (1ull<<27);
       const uint64_t CELL_GRADPE_TERM         = (1ull<<28);
+      const uint64_t VEL_BLOCK_DATA_COMPRESSED_SIZE = (1ull<<29); /**< Length of the data packed by compress_block_data.*/
       //all data
       const uint64_t ALL_DATA =
       CELL_PARAMETERS
@@ -188,10 +193,13 @@ namespace spatial_cell {
       const Realf* get_data(const uint popID) const;
       Realf* get_data(const vmesh::LocalID& blockLID,const uint popID);
       const Realf* get_data(const vmesh::LocalID& blockLID,const uint popID) const;
+      #ifndef DERIVED_BLOCK_PARAMETERS
       Real* get_block_parameters(const uint popID);
       const Real* get_block_parameters(const uint popID) const;
       Real* get_block_parameters(const vmesh::LocalID& blockLID,const uint popID);
       const Real* get_block_parameters(const vmesh::LocalID& blockLID,const uint popID) const;
+      #endif
+      void get_block_info(const vmesh::LocalID& blockLID,const uint popID,Real* blockParams) const;
 
       Real* get_cell_parameters();
       const Real* get_cell_parameters() const;
@@ -270,6 +278,9 @@ namespace spatial_cell {
       void update_velocity_block_content_lists(const uint popID);
       bool checkMesh(const uint popID);
       void clear(const uint popID);
+      void compress_block_data(const uint popID,const Realf cutoff);
+      bool decompress_block_data(const uint popID);
+      void release_compressed_block_data();
       void coarsen_block(const vmesh::GlobalID& parent,const std::vector<vmesh::GlobalID>& children,const uint popID);
       void coarsen_blocks(amr_ref_criteria::Base* evaluator,const uint popID);
       uint64_t get_cell_memory_capacity();
@@ -305,6 +316,8 @@ namespace spatial_cell {
       static uint64_t get_mpi_transfer_type(void);
       static void set_mpi_transfer_type(const uint64_t type,bool atSysBoundaries=false);
       void set_mpi_transfer_enabled(bool transferEnabled);
+      static void set_valid_remote_copies(std::set<std::pair<CellID,int> >& copies);
+      static bool is_valid_remote_copy(const CellID cellID,const int rank);
       void updateSparseMinValue(const uint popID);
       Real getVelocityBlockMinValue(const uint popID) const;
 
@@ -330,6 +343,9 @@ namespace spatial_cell {
                                                                                * cell block data. We do not allocate memory for the pointer.*/
       std::array<vmesh::LocalID,MAX_NEIGHBORS_PER_DIM> neighbor_number_of_blocks;
       std::map<int,std::set<int>> face_neighbor_ranks;
+      std::vector<char> compressedBlockData;                                  /**< Block data packed for Transfer::VEL_BLOCK_DATA_COMPRESSED.*/
+      uint64_t compressedBlockDataSize;                                       /**< Length of compressedBlockData, for Transfer::VEL_BLOCK_DATA_COMPRESSED_SIZE.*/
+      bool compressedBlockDataReceived;                                       /**< If true, compressedBlockData has been received and not yet unpacked.*/
       uint sysBoundaryFlag;                                                   /**< What type of system boundary does the cell belong to. 
                                                                                * Enumerated in the sysboundarytype namespace's enum.*/
       uint sysBoundaryLayer;                                                  /**< Layers counted from closest systemBoundary. If 0 then it has not 
@@ -343,6 +359,9 @@ namespace spatial_cell {
                                                                                * over MPI, so is invalid on remote cells.*/
       static uint64_t mpi_transfer_type;                                      /**< Which data is transferred by the mpi datatype given by spatial cells.*/
       static bool mpiTransferAtSysBoundaries;                                 /**< Do we only transfer data at boundaries (true), or in the whole system (false).*/
+      static std::set<std::pair<CellID,int> > validRemoteCopies;              /**< Pairs of (cell, other process) between which the velocity block
+                                                                               * lists are already up to date and are not transferred, see
+                                                                               * set_valid_remote_copies.*/
 
       //SpatialCell& operator=(const SpatialCell& other);
     private:
@@ -820,6 +839,7 @@ namespace spatial_cell {
       return populations[popID].blockContainer.getData(blockLID);
    }
 
+   #ifndef DERIVED_BLOCK_PARAMETERS
    inline Real* SpatialCell::get_block_parameters(const uint popID) {
       #ifdef DEBUG_SPATIAL_CELL
       if (popID >= populations.size()) {
@@ -873,7 +893,35 @@ namespace spatial_cell {
       #endif
       return populations[popID].blockContainer.getParameters(blockLID);
    }
-   
+   #endif
+
+   /** Get the parameters of a velocity block, indexed by BlockParams. With
+    * DERIVED_BLOCK_PARAMETERS they are computed from the global ID of the block,
+    * otherwise they are copied from the block container.
+    * @param blockLID Local ID of the velocity block.
+    * @param popID Population ID.
+    * @param blockParams Array of BlockParams::N_VELOCITY_BLOCK_PARAMS values where the parameters are written.*/
+   inline void SpatialCell::get_block_info(const vmesh::LocalID& blockLID,const uint popID,Real* blockParams) const {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      if (blockLID >= populations[popID].blockContainer.size()) {
+         std::cerr << "ERROR, block LID out of bounds, blockContainer.size() " << populations[popID].blockContainer.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+         exit(1);
+      }
+      #endif
+      #ifdef DERIVED_BLOCK_PARAMETERS
+      populations[popID].vmesh.getBlockInfo(populations[popID].vmesh.getGlobalID(blockLID),blockParams);
+      #else
+      const Real* parameters = populations[popID].blockContainer.getParameters(blockLID);
+      for (int i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) blockParams[i] = parameters[i];
+      #endif
+   }
+
    inline Real* SpatialCell::get_cell_parameters() {
       return parameters.data();
    }
@@ -1599,7 +1647,7 @@ namespace spatial_cell {
     functions of the containers in spatial cell
     */
    inline uint64_t SpatialCell::get_cell_memory_size() {
-      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real);
+      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + vmesh::N_STORED_BLOCK_PARAMS*sizeof(Real);
       uint64_t size = 0;
       size += vmeshTemp.sizeInBytes();
       size += blockContainerTemp.sizeInBytes();
@@ -1623,7 +1671,7 @@ namespace spatial_cell {
     the size() functions of the containers in spatial cell
     */
    inline uint64_t SpatialCell::get_cell_memory_capacity() {
-      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real);
+      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + vmesh::N_STORED_BLOCK_PARAMS*sizeof(Real);
       uint64_t capacity = 0;
       
       capacity += vmeshTemp.capacityInBytes();
@@ -1672,12 +1720,14 @@ namespace spatial_cell {
       for (unsigned int i=0; i<WID*WID*WID; ++i) data[i] = 0;
 
       // Set block parameters:
+      #ifndef DERIVED_BLOCK_PARAMETERS
 //      Real* parameters = get_block_parameters(populations[popID].vmesh.getLocalID(block));
       Real* parameters = get_block_parameters(VBC_LID,popID);
       parameters[BlockParams::VXCRD] = get_velocity_block_vx_min(popID,block);
       parameters[BlockParams::VYCRD] = get_velocity_block_vy_min(popID,block);
       parameters[BlockParams::VZCRD] = get_velocity_block_vz_min(popID,block);
       populations[popID].vmesh.getCellSize(block,&(parameters[BlockParams::DVX]));
+      #endif
 
       // The following call 'should' be the fastest, but is actually 
       // much slower that the parameter setting above
@@ -1702,8 +1752,7 @@ namespace spatial_cell {
       }
 
       // Add blocks to block container
-      vmesh::LocalID startLID = populations[popID].blockContainer.push_back(blocks.size());
-      Real* parameters = populations[popID].blockContainer.getParameters(startLID);
+      populations[popID].blockContainer.push_back(blocks.size());
 
       #ifdef DEBUG_SPATIAL_CELL
          if (populations[popID].vmesh.size() != populations[popID].blockContainer.size()) {
@@ -1712,6 +1761,9 @@ namespace spatial_cell {
       #endif
 
       // Set block parameters
+      #ifndef DERIVED_BLOCK_PARAMETERS
+      const vmesh::LocalID startLID = populations[popID].blockContainer.size() - blocks.size();
+      Real* parameters = populations[popID].blockContainer.getParameters(startLID);
       for (size_t b=0; b<blocks.size(); ++b) {
          parameters[BlockParams::VXCRD] = get_velocity_block_vx_min(popID,blocks[b]);
          parameters[BlockParams::VYCRD] = get_velocity_block_vy_min(popID,blocks[b]);
@@ -1719,6 +1771,7 @@ namespace spatial_cell {
          populations[popID].vmesh.getCellSize(blocks[b],&(parameters[BlockParams::DVX]));
          parameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
+      #endif
    }
 
    inline bool SpatialCell::add_velocity_block_octant(const vmesh::GlobalID& blockGID,const uint popID) {
@@ -1865,6 +1918,24 @@ namespace spatial_cell {
       this->mpiTransferEnabled=transferEnabled;
    }
    
+   /*!
+    Set the remote copies whose velocity block lists are known to be up to date, e.g. kept over a load
+    balance. Each pair is (cell, other process): on the process owning the cell the other process holds the
+    copy, on the process holding the copy it is the owner. The block lists of these are skipped in
+    VEL_BLOCK_LIST_STAGE1/2 transfers until the set is cleared by passing an empty one. The contents of
+    copies are swapped in.
+    */
+   inline void SpatialCell::set_valid_remote_copies(std::set<std::pair<CellID,int> >& copies) {
+      SpatialCell::validRemoteCopies.swap(copies);
+   }
+   
+   /*!
+    Whether the velocity block lists of the cell are up to date between this process and the given one.
+    */
+   inline bool SpatialCell::is_valid_remote_copy(const CellID cellID,const int rank) {
+      return SpatialCell::validRemoteCopies.count(std::make_pair(cellID,rank)) > 0;
+   }
+   
    inline bool SpatialCell::velocity_block_has_children(const vmesh::GlobalID& blockGID,const uint popID) const {
       #ifdef DEBUG_SPATIAL_CELL
       if (popID >= populations.size()) {
@@ -830,7 +830,8 @@ namespace SBC {
          for (size_t i = 0; i < blocksToInitialize.size(); i++) {
             const vmesh::GlobalID blockGID = blocksToInitialize.at(i);
             const vmesh::LocalID blockLID = templateCell.get_velocity_block_local_id(blockGID,popID);
-            const Real* block_parameters = templateCell.get_block_parameters(blockLID,popID);
+            Real block_parameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+            templateCell.get_block_info(blockLID,popID,block_parameters);
             creal vxBlock = block_parameters[BlockParams::VXCRD];
             creal vyBlock = block_parameters[BlockParams::VYCRD];
             creal vzBlock = block_parameters[BlockParams::VZCRD];
@@ -904,6 +905,11 @@ namespace SBC {
       templateCell.parameters[CellParams::P_11_V] = templateCell.parameters[CellParams::P_11];
       templateCell.parameters[CellParams::P_22_V] = templateCell.parameters[CellParams::P_22];
       templateCell.parameters[CellParams::P_33_V] = templateCell.parameters[CellParams::P_33];
+      
+      // The boundary cells copied from the template share its velocity blocks until they are modified
+      for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         templateCell.get_velocity_blocks(popID).makeShareable();
+      }
    }
    
    Real Ionosphere::shiftedMaxwellianDistribution(
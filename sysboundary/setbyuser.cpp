@@ -472,6 +472,10 @@ namespace SBC {
          int index;
          if(facesToProcess[i]) {
             generateTemplateCell(templateCells[i], templateB[i], i, t);
+            // The boundary cells copied from the template share its velocity blocks until they are modified
+            for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+               templateCells[i].get_velocity_blocks(popID).makeShareable();
+            }
          }
       }
       return true;
@@ -666,8 +666,12 @@ void SysBoundary::applySysBoundaryVlasovConditions(
    
       #pragma omp parallel for
       for (uint i=0; i<localCells.size(); i++) {
+         const double t1 = MPI_Wtime();
          cuint sysBoundaryType = mpiGrid[localCells[i]]->sysBoundaryFlag;
          this->getSysBoundary(sysBoundaryType)->vlasovBoundaryCondition(mpiGrid,localCells[i],popID,calculate_V_moments);
+         if (Parameters::prepareForRebalance == true) {
+            mpiGrid[localCells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] += MPI_Wtime() - t1;
+         }
       }
       if (calculate_V_moments) {
          calculateMoments_V(mpiGrid, localCells, true);
@@ -688,8 +692,12 @@ void SysBoundary::applySysBoundaryVlasovConditions(
       getBoundaryCellList(mpiGrid,mpiGrid.get_local_cells_on_process_boundary(SYSBOUNDARIES_NEIGHBORHOOD_ID),boundaryCells);
       #pragma omp parallel for
       for (uint i=0; i<boundaryCells.size(); i++) {
+         const double t1 = MPI_Wtime();
          cuint sysBoundaryType = mpiGrid[boundaryCells[i]]->sysBoundaryFlag;
          this->getSysBoundary(sysBoundaryType)->vlasovBoundaryCondition(mpiGrid, boundaryCells[i],popID,calculate_V_moments);
+         if (Parameters::prepareForRebalance == true) {
+            mpiGrid[boundaryCells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] += MPI_Wtime() - t1;
+         }
       }
       if (calculate_V_moments) {
          calculateMoments_V(mpiGrid, boundaryCells, true);
@@ -31,6 +31,7 @@
 #include <iostream>
 
 #include "../parameters.h"
+#include "../object_wrapper.h"
 #include "../vlasovmover.h"
 #include "sysboundarycondition.h"
 #include "../projects/projects_common.h"
@@ -250,7 +251,7 @@ namespace SBC {
          cerr << __FILE__ << ":" << __LINE__ << ": No closest cell found!" << endl;
          abort();
       }
-      averageCellData(mpiGrid, closestCells, mpiGrid[cellID], popID, calculate_V_moments);
+      averageCellData(mpiGrid, closestCells, cellID, popID, calculate_V_moments);
    }
    
    /*! Function used to average and copy the distribution and moments from all the close sysboundarytype::NOT_SYSBOUNDARY cells.
@@ -267,7 +268,7 @@ namespace SBC {
          cerr << __FILE__ << ":" << __LINE__ << ": No close cell found!" << endl;
          abort();
       }
-      averageCellData(mpiGrid, closeCells, mpiGrid[cellID], popID, calculate_V_moments, fluffiness);
+      averageCellData(mpiGrid, closeCells, cellID, popID, calculate_V_moments, fluffiness);
    }
    
    /*! Function used to copy the distribution from (one of) the closest sysboundarytype::NOT_SYSBOUNDARY cell but limiting to values no higher than where it can flow into. Moments are recomputed.
@@ -291,16 +292,27 @@ namespace SBC {
       const std::array<SpatialCell*,27> flowtoCells = getFlowtoCells(cellID);
       //Do not allow block adjustment, the block structure when calling vlasovBoundaryCondition should be static
       //just copy data to existing blocks, no modification of to blocks allowed
+      // Slot 0 holds the blocks of the closest cell, slot 1+nbrID those of the flowto cells
+      std::vector<BlockCorrespondence> & tables = getBlockCorrespondences(cellID, popID);
+      tables.resize(1 + flowtoCells.size());
+      updateBlockCorrespondence(tables[0], to, from, popID, false);
+      for (uint i=0; i<flowtoCells.size(); i++) {
+         if(flowtoCells[i]) {
+            updateBlockCorrespondence(tables[1+i], to, flowtoCells[i], popID, false);
+         }
+      }
+      
       for (vmesh::LocalID blockLID=0; blockLID<to->get_number_of_velocity_blocks(popID); ++blockLID) {
-         const vmesh::GlobalID blockGID = to->get_velocity_block_global_id(blockLID,popID);
-//          const Realf* fromBlock_data = from->get_data(from->get_velocity_block_local_id(blockGID) );
          Realf* toBlock_data = to->get_data(blockLID,popID);
-         if (from->get_velocity_block_local_id(blockGID,popID) == from->invalid_local_id()) {
+         const vmesh::LocalID fromBlockLID = tables[0][blockLID];
+         if (fromBlockLID == from->invalid_local_id()) {
             for (unsigned int i = 0; i < VELOCITY_BLOCK_LENGTH; i++) {
                toBlock_data[i] = 0.0; //block did not exist in from cell, fill with zeros.
             }
          } else {
-            const Real* blockParameters = to->get_block_parameters(blockLID, popID);
+            const Realf* fromBlock_data = from->get_data(fromBlockLID,popID);
+            Real blockParameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+            to->get_block_info(blockLID,popID,blockParameters);
             // check where cells are
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
@@ -309,13 +321,19 @@ namespace SBC {
             creal dvyCell = blockParameters[BlockParams::DVY];
             creal dvzCell = blockParameters[BlockParams::DVZ];
             
-            std::array<Realf*,27> flowtoCellsBlockCache = getFlowtoCellsBlock(flowtoCells, blockGID, popID);
+            // Blocks missing from a flowto cell point to the zero block of that cell
+            std::array<const Realf*,27> flowtoCellsBlock;
+            flowtoCellsBlock.fill(NULL);
+            for (uint i=0; i<flowtoCells.size(); i++) {
+               if(flowtoCells[i]) {
+                  flowtoCellsBlock[i] = flowtoCells[i]->get_data(tables[1+i][blockLID], popID);
+               }
+            }
             
             for (uint kc=0; kc<WID; ++kc) {
                for (uint jc=0; jc<WID; ++jc) {
                   for (uint ic=0; ic<WID; ++ic) {
-                     velocity_cell_indices_t indices = {ic, jc, kc};
-                     const uint cell = from->get_velocity_cell(indices);
+                     const uint cell = cellIndex(ic,jc,kc);
                      
                      creal vxCellCenter = vxBlock + (ic+convert<Real>(0.5))*dvxCell;
                      creal vyCellCenter = vyBlock + (jc+convert<Real>(0.5))*dvyCell;
@@ -323,19 +341,19 @@ namespace SBC {
                      const int vxCellSign = vxCellCenter < 0 ? -1 : 1;
                      const int vyCellSign = vyCellCenter < 0 ? -1 : 1;
                      const int vzCellSign = vzCellCenter < 0 ? -1 : 1;
-                     Realf value = from->get_value(blockGID, cell, popID);
+                     Realf value = fromBlock_data[cell];
                      //loop over spatial cells in quadrant of influence
                      for(int dvx = 0 ; dvx <= 1; dvx++) {
                         for(int dvy = 0 ; dvy <= 1; dvy++) {
                            for(int dvz = 0 ; dvz <= 1; dvz++) {
                               const int flowToId = nbrID(dvx * vxCellSign, dvy * vyCellSign, dvz * vzCellSign);
-                              if(flowtoCells.at(flowToId)){
-                                 value = min(value, flowtoCellsBlockCache.at(flowToId)[cell]);
+                              if(flowtoCellsBlock[flowToId]){
+                                 value = min(value, flowtoCellsBlock[flowToId][cell]);
                               }
                            }
                         }
                      }
-                     to->set_value(blockGID, cell,  value, popID);
+                     toBlock_data[cell] = value;
                   }
                }
             }
@@ -400,57 +418,55 @@ namespace SBC {
    /*! Take a list of cells and set the destination cell distribution function to the average of the list's cells'.
     * \param mpiGrid Grid
     * \param cellList Vector of cells to copy from.
-    * \param to Pointer to cell in which to set the averaged distribution.
+    * \param cellID The cell in which to set the averaged distribution.
     */
    void SysBoundaryCondition::averageCellData(
          const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-         const std::vector<CellID> cellList,
-         SpatialCell *to,
+         const std::vector<CellID>& cellList,
+         const CellID& cellID,
          const uint popID,
          const bool calculate_V_moments,
          creal fluffiness /* default =0.0*/
    ) {
+      // Constant boundary, also keeps blocks shared with a template cell shared
+      if (fluffiness == 0.0) return;
+      
+      SpatialCell* to = mpiGrid[cellID];
       const size_t numberOfCells = cellList.size();
       creal factor = fluffiness / convert<Real>(numberOfCells);
       
-
+      // Find the target blocks of the incoming blocks, creating the missing ones,
+      // before taking pointers to the target data as adding blocks may move it.
+      std::vector<BlockCorrespondence> & tables = getBlockCorrespondences(cellID, popID);
+      if (tables.size() < numberOfCells) tables.resize(numberOfCells);
+      for (size_t i=0; i<numberOfCells; i++) {
+         updateBlockCorrespondence(tables[i], mpiGrid[cellList[i]], to, popID, true);
+      }
+      
       // Rescale own vspace
-      const Realf* toData = to->get_data(popID);
-      for (vmesh::LocalID toBlockLID=0; toBlockLID<to->get_number_of_velocity_blocks(popID); ++toBlockLID) {
-         // Pointer to target block data
-         Realf* toData = to->get_data(toBlockLID,popID);
-         
-         // Add values from source cells
-         for (uint kc=0; kc<WID; ++kc) for (uint jc=0; jc<WID; ++jc) for (uint ic=0; ic<WID; ++ic) {
-            toData[cellIndex(ic,jc,kc)] *= 1.0 - fluffiness;
-         }
-         toData += SIZE_VELBLOCK;
-      } // for-loop over velocity blocks
-
+      Realf* toData = to->get_data(popID);
+      const size_t nToValues = to->get_number_of_velocity_blocks(popID) * WID3;
+      const Realf ownFactor = 1.0 - fluffiness;
+      #pragma omp simd
+      for (size_t c=0; c<nToValues; ++c) {
+         toData[c] *= ownFactor;
+      }
       
       for (size_t i=0; i<numberOfCells; i++) {
          const SpatialCell* incomingCell = mpiGrid[cellList[i]];
-
+         const BlockCorrespondence & table = tables[i];
+         
          const Realf* fromData = incomingCell->get_data(popID);
          for (vmesh::LocalID incBlockLID=0; incBlockLID<incomingCell->get_number_of_velocity_blocks(popID); ++incBlockLID) {
-            // Global ID of the block containing incoming data
-            vmesh::GlobalID incBlockGID = incomingCell->get_velocity_block_global_id(incBlockLID,popID);
-            
-            // Get local ID of the target block. If the block doesn't exist, create it.
-            vmesh::GlobalID toBlockLID = to->get_velocity_block_local_id(incBlockGID,popID);
-            if (toBlockLID == SpatialCell::invalid_local_id()) {
-               to->add_velocity_block(incBlockGID,popID);
-               toBlockLID = to->get_velocity_block_local_id(incBlockGID,popID);
-            }
-            
             // Pointer to target block data
-            Realf* toData = to->get_data(toBlockLID,popID);
-
+            Realf* toBlockData = toData + table[incBlockLID]*WID3;
+            const Realf* fromBlockData = fromData + incBlockLID*WID3;
+            
             // Add values from source cells
-            for (uint kc=0; kc<WID; ++kc) for (uint jc=0; jc<WID; ++jc) for (uint ic=0; ic<WID; ++ic) {
-               toData[cellIndex(ic,jc,kc)] += factor*fromData[cellIndex(ic,jc,kc)];
+            #pragma omp simd
+            for (uint c=0; c<WID3; ++c) {
+               toBlockData[c] += factor*fromBlockData[c];
             }
-            fromData += SIZE_VELBLOCK;
          } // for-loop over velocity blocks
       }
    }
@@ -480,11 +496,12 @@ namespace SBC {
       
       for (size_t i=0; i<numberOfCells; i++) {
          SpatialCell* incomingCell = mpiGrid[cellList[i]];
-         const Real* blockParameters = incomingCell->get_block_parameters(popID);
+         Real blockParameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // add blocks
          for (vmesh::LocalID blockLID=0; blockLID<incomingCell->get_number_of_velocity_blocks(popID); ++blockLID) {
             // check where cells are
+            incomingCell->get_block_info(blockLID,popID,blockParameters);
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
             creal vzBlock = blockParameters[BlockParams::VZCRD];
@@ -518,7 +535,6 @@ namespace SBC {
                }
             } // for-loop over cells in velocity block
          } // for-loop over velocity blocks
-         blockParameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       } // for-loop over spatial cells
    }
    
@@ -549,11 +565,12 @@ namespace SBC {
       
       for (size_t i=0; i<numberOfCells; i++) {
          SpatialCell* incomingCell = mpiGrid[cellList[i]];
-         const Real* blockParameters = incomingCell->get_block_parameters(popID);
+         Real blockParameters[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          
          // add blocks
          for (vmesh::LocalID blockLID=0; blockLID<incomingCell->get_number_of_velocity_blocks(popID); ++blockLID) {
             // check where cells are
+            incomingCell->get_block_info(blockLID,popID,blockParameters);
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
             creal vzBlock = blockParameters[BlockParams::VZCRD];
@@ -589,7 +606,6 @@ namespace SBC {
                      }
             }
          } // for-loop over velocity blocks
-         blockParameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       } // for-loop over spatial cells
    }
 
@@ -603,14 +619,23 @@ namespace SBC {
       dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
       const vector<CellID> & local_cells_on_boundary
    ) {
+      // The block tables are kept for the cells that stay on this process and have the same source
+      // cells as before, the tables of the others are freed. Kept entries are checked on use, as the
+      // blocks of the cells may have changed.
+      std::unordered_map<CellID, std::vector<std::vector<BlockCorrespondence>>> oldBlockCorrespondences;
+      oldBlockCorrespondences.swap(allBlockCorrespondences);
+      
       // Loop over cellids
       for( vector<CellID>::const_iterator it = local_cells_on_boundary.begin(); it != local_cells_on_boundary.end(); ++it ) {
          const CellID cellId = *it;
          std::vector<CellID> & closestCells = allClosestNonsysboundaryCells[cellId];
+         const std::vector<CellID> oldClosestCells = closestCells;
          closestCells.clear();
          std::vector<CellID> & closeCells = allCloseNonsysboundaryCells[cellId];
+         const std::vector<CellID> oldCloseCells = closeCells;
          closeCells.clear();
          std::array<SpatialCell*,27> & flowtoCells = allFlowtoCells[cellId];
+         const std::array<SpatialCell*,27> oldFlowtoCells = flowtoCells;
          flowtoCells.fill(NULL);
          uint dist = numeric_limits<uint>::max();
       
@@ -655,6 +680,15 @@ namespace SBC {
                }
          if(closestCells.size() == 0) closestCells.push_back(INVALID_CELLID);
          if(closeCells.size() == 0) closeCells.push_back(INVALID_CELLID);
+         
+         std::vector<std::vector<BlockCorrespondence>> & tables = allBlockCorrespondences[cellId];
+         auto oldTables = oldBlockCorrespondences.find(cellId);
+         if (oldTables != oldBlockCorrespondences.end() && closestCells == oldClosestCells
+             && closeCells == oldCloseCells && flowtoCells == oldFlowtoCells) {
+            tables.swap(oldTables->second);
+         } else {
+            tables.resize(getObjectWrapper().particleSpecies.size());
+         }
       }
       return true;
    }
@@ -768,21 +802,51 @@ namespace SBC {
       return flowtoCells;
    }
    
-   std::array<Realf*,27> SysBoundaryCondition::getFlowtoCellsBlock(
-      const std::array<SpatialCell*,27> flowtoCells,
-      const vmesh::GlobalID blockGID,
+   /*! Get the block correspondence tables of a boundary cell for one population. The boundary
+    * scheme decides which source cell each table slot is used for and resizes the vector.
+    * \param cellID ID of the boundary cell.
+    * \param popID ID of the particle species.
+    * \return The tables of the cell, see updateBlockCorrespondence
+    */
+   std::vector<SysBoundaryCondition::BlockCorrespondence> & SysBoundaryCondition::getBlockCorrespondences(
+      const CellID& cellID,
       const uint popID
    ) {
-      phiprof::start("getFlowtoCellsBlock");
-      std::array<Realf*,27> flowtoCellsBlock;
-      flowtoCellsBlock.fill(NULL);
-      for (uint i=0; i<27; i++) {
-         if(flowtoCells.at(i)) {
-            flowtoCellsBlock.at(i) = flowtoCells.at(i)->get_data(flowtoCells.at(i)->get_velocity_block_local_id(blockGID,popID), popID);
+      return allBlockCorrespondences.at(cellID).at(popID);
+   }
+   
+   /*! Update the table of the local IDs in cell other of the velocity blocks of cell, in the order of
+    * the blocks of cell. An entry is kept if it still points to a block with the same global ID, so
+    * the tables built in one call are reused as long as the block structures do not change, and only
+    * the changed blocks are looked up again after adjusting the blocks.
+    * \param table Table to update.
+    * \param cell Cell whose blocks are looked up.
+    * \param other Cell in which the blocks are looked up.
+    * \param popID ID of the particle species.
+    * \param addMissingBlocks If true, blocks missing from other are created, otherwise their entry is the invalid local ID.
+    */
+   void SysBoundaryCondition::updateBlockCorrespondence(
+      BlockCorrespondence& table,
+      const SpatialCell* cell,
+      SpatialCell* other,
+      const uint popID,
+      const bool addMissingBlocks
+   ) {
+      const vmesh::LocalID nBlocks = cell->get_number_of_velocity_blocks(popID);
+      table.resize(nBlocks, SpatialCell::invalid_local_id());
+      for (vmesh::LocalID blockLID=0; blockLID<nBlocks; ++blockLID) {
+         const vmesh::GlobalID blockGID = cell->get_velocity_block_global_id(blockLID,popID);
+         vmesh::LocalID & otherLID = table[blockLID];
+         if (otherLID < other->get_number_of_velocity_blocks(popID)
+             && other->get_velocity_block_global_id(otherLID,popID) == blockGID) {
+            continue;
+         }
+         otherLID = other->get_velocity_block_local_id(blockGID,popID);
+         if (otherLID == SpatialCell::invalid_local_id() && addMissingBlocks) {
+            other->add_velocity_block(blockGID,popID);
+            otherLID = other->get_velocity_block_local_id(blockGID,popID);
          }
       }
-      phiprof::stop("getFlowtoCellsBlock");
-      return flowtoCellsBlock;
    }
    
    Real SysBoundaryCondition::fieldBoundaryCopyFromExistingFaceNbrMagneticField(
@@ -182,8 +182,8 @@ namespace SBC {
          );
          void averageCellData(
             const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-            std::vector<CellID> cellList,
-            SpatialCell *to,
+            const std::vector<CellID>& cellList,
+            const CellID& cellID,
             const uint popID,
             const bool calculate_V_moments,
             creal fluffiness = 0
@@ -192,11 +192,20 @@ namespace SBC {
                const CellID& cellID
          );
 
-         std::array<Realf*,27> getFlowtoCellsBlock(
-               const std::array<SpatialCell*,27> flowtoCells,
-               const vmesh::GlobalID blockGID,
+         /*! Local IDs, in another cell, of the velocity blocks of a cell. See updateBlockCorrespondence. */
+         typedef std::vector<vmesh::LocalID> BlockCorrespondence;
+
+         std::vector<BlockCorrespondence> & getBlockCorrespondences(
+               const CellID& cellID,
                const uint popID
          );
+         void updateBlockCorrespondence(
+               BlockCorrespondence& table,
+               const SpatialCell* cell,
+               SpatialCell* other,
+               const uint popID,
+               const bool addMissingBlocks
+         );
       
 
       /*! Helper function to get the index of a neighboring cell in the arrays in allFlowtoCells.
@@ -294,6 +303,11 @@ namespace SBC {
       
          /*! Array of cells into which the distribution function can flow. Used in getAllFlowtoCells. Cells into which one cannot flow are set to INVALID_CELLID. */
          std::unordered_map<CellID, std::array<SpatialCell*, 27>> allFlowtoCells;
+         /*! Block correspondence tables of each boundary cell, indexed by population and by the source cell slot of the boundary scheme. Used in getBlockCorrespondences.
+          * A table costs sizeof(vmesh::LocalID) = 4 bytes per block of the cell it maps. vlasovBoundaryCopyFromTheClosestNbrAndLimit keeps up to 28 tables
+          * (the closest cell and the flowto cells) per population, e.g. about 1.1 MB per population for a cell with 10^4 blocks, averageCellData one
+          * per close cell. Tables of cells whose source cells change in updateSysBoundaryConditionsAfterLoadBalance are freed. */
+         std::unordered_map<CellID, std::vector<std::vector<BlockCorrespondence>>> allBlockCorrespondences;
          /*! bool telling whether to call again applyInitialState upon restarting the simulation. */
          bool applyUponRestart;
    };
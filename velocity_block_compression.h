@@ -0,0 +1,96 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef VELOCITY_BLOCK_COMPRESSION_H
+#define VELOCITY_BLOCK_COMPRESSION_H
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "common.h"
+
+/** Packing of velocity block data for Transfer::VEL_BLOCK_DATA_COMPRESSED. Each block
+ * is stored as a 64-bit mask of the cells that are kept followed by their values, so
+ * empty blocks and sparse blocks near the sparsity threshold shrink to a few bytes.
+ * Kept separate from SpatialCell so that mini-apps/compressed_transfer can test it.*/
+namespace vblock {
+
+   /** Pack nBlocks blocks of data into buffer. Values whose magnitude is not above
+    * cutoff are dropped and unpacked as zeros, with cutoff 0 the packing is lossless.
+    * @param data Block data, nBlocks*WID3 values.
+    * @param nBlocks Number of blocks.
+    * @param cutoff Largest absolute value that is dropped.
+    * @param buffer Packed data, resized to its exact length.*/
+   inline void compressBlockData(const Realf* data,const size_t nBlocks,const Realf cutoff,std::vector<char>& buffer) {
+      static_assert(WID3 <= 64,"Block cell mask of compressed transfers does not fit in 64 bits");
+      buffer.resize(nBlocks * (sizeof(uint64_t) + sizeof(Realf)*WID3));
+
+      char* out = buffer.data();
+      for (size_t blockLID=0; blockLID<nBlocks; ++blockLID) {
+         const Realf* blockData = data + blockLID*WID3;
+         char* maskPosition = out;
+         out += sizeof(uint64_t);
+
+         uint64_t mask = 0;
+         for (int i=0; i<WID3; ++i) {
+            // Written unconditionally and overwritten if dropped, keeps the loop branch free
+            std::memcpy(out,blockData+i,sizeof(Realf));
+            const bool keep = !(std::fabs(blockData[i]) <= cutoff);
+            mask |= (uint64_t) keep << i;
+            out += keep * sizeof(Realf);
+         }
+         std::memcpy(maskPosition,&mask,sizeof(uint64_t));
+      }
+      buffer.resize(out - buffer.data());
+   }
+
+   /** Unpack data packed by compressBlockData into nBlocks blocks.
+    * @param buffer Packed data.
+    * @param size Length of the packed data in bytes.
+    * @param data Block data, nBlocks*WID3 values.
+    * @param nBlocks Number of blocks.
+    * @return If false, the packed data does not hold exactly nBlocks blocks.*/
+   inline bool decompressBlockData(const char* buffer,const size_t size,Realf* data,const size_t nBlocks) {
+      const char* in = buffer;
+      const char* end = buffer + size;
+      for (size_t blockLID=0; blockLID<nBlocks; ++blockLID) {
+         if (in + sizeof(uint64_t) > end) return false;
+         uint64_t mask;
+         std::memcpy(&mask,in,sizeof(uint64_t));
+         in += sizeof(uint64_t);
+
+         Realf* blockData = data + blockLID*WID3;
+         for (int i=0; i<WID3; ++i) {
+            if ((mask >> i) & 1) {
+               if (in + sizeof(Realf) > end) return false;
+               std::memcpy(blockData+i,in,sizeof(Realf));
+               in += sizeof(Realf);
+            } else {
+               blockData[i] = 0.0;
+            }
+         }
+      }
+      return in == end;
+   }
+
+} // namespace vblock
+
+#endif
@@ -23,9 +23,14 @@
 #ifndef VELOCITY_BLOCK_CONTAINER_H
 #define VELOCITY_BLOCK_CONTAINER_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
 #include <vector>
 
 #include "common.h"
+#include "memoryallocation.h"
 #include "unistd.h"
 
 #ifdef DEBUG_VBC
@@ -36,11 +41,122 @@ namespace vmesh {
 
    static const double BLOCK_ALLOCATION_FACTOR = 1.1;
 
+   /** Capacity is increased by this factor when a full container grows. The previous
+    * std::vector storage effectively doubled its capacity when resized, growing in
+    * steps of BLOCK_ALLOCATION_FACTOR would copy the blocks far too often.*/
+   static const double BLOCK_GROWTH_FACTOR = 1.5;
+
+   /** Memory for velocity blocks is handed out in size classes, eight per power of two,
+    * so that a requested capacity is rounded up by at most 12.5%. Class 0 holds up to
+    * eight blocks.*/
+   static const unsigned int N_BLOCK_SIZE_CLASSES = 256;
+
+   /** Maximum number of bytes each thread keeps in its pool of free block buffers.*/
+   static const size_t MAX_POOLED_BYTES_PER_THREAD = 32*1024*1024;
+
+   /** Number of block parameters (see BlockParams) stored with each block. With
+    * DERIVED_BLOCK_PARAMETERS none are stored, SpatialCell::get_block_info computes
+    * them from the global ID of the block instead.*/
+   #ifdef DERIVED_BLOCK_PARAMETERS
+   static const int N_STORED_BLOCK_PARAMS = 0;
+   #else
+   static const int N_STORED_BLOCK_PARAMS = BlockParams::N_VELOCITY_BLOCK_PARAMS;
+   #endif
+
+   /** Bytes of one velocity block, i.e., its distribution function and parameters.*/
+   static const size_t BYTES_PER_BLOCK = WID3*sizeof(Realf) + N_STORED_BLOCK_PARAMS*sizeof(Real);
+
+   inline unsigned int blockSizeClass(const size_t& nBlocks) {
+      if (nBlocks <= 8) return 0;
+      const unsigned int power = 63 - __builtin_clzll(nBlocks-1);
+      const size_t step = size_t(1) << (power-3);
+      return (power-3)*8 + (nBlocks+step-1)/step - 8;
+   }
+
+   inline size_t blockSizeClassCapacity(const unsigned int& sizeClass) {
+      if (sizeClass == 0) return 8;
+      return size_t(9 + (sizeClass-1)%8) << ((sizeClass-1)/8);
+   }
+
+   /** Per-thread cache of freed velocity block buffers. Cells grow and shrink all the
+    * time in acceleration and adjust_velocity_blocks, and the buffers released by one
+    * cell are taken into use by the next one instead of going through malloc again.
+    * Buffers may be released by a different thread than the one that allocated them.*/
+   class BlockBufferPool {
+    public:
+      BlockBufferPool(bool& destroyed): cachedBytes(0),destroyed(destroyed) { }
+      ~BlockBufferPool() {
+         release();
+         destroyed = true;
+      }
+
+      /** Get a buffer of the given size class, or of the next larger one if that is available.
+       * @param sizeClass Requested size class, changed to the size class of the returned buffer.*/
+      char* allocate(unsigned int& sizeClass) {
+         for (unsigned int c=sizeClass; c<sizeClass+2 && c<N_BLOCK_SIZE_CLASSES; ++c) {
+            if (freeBuffers[c].size() == 0) continue;
+            char* buffer = freeBuffers[c].back();
+            freeBuffers[c].pop_back();
+            cachedBytes -= blockSizeClassCapacity(c)*BYTES_PER_BLOCK;
+            sizeClass = c;
+            return buffer;
+         }
+         return allocateNew(sizeClass);
+      }
+
+      void deallocate(char* buffer,const unsigned int& sizeClass) {
+         const size_t bytes = blockSizeClassCapacity(sizeClass)*BYTES_PER_BLOCK;
+         if (cachedBytes + bytes > MAX_POOLED_BYTES_PER_THREAD) {
+            aligned_free(buffer);
+            return;
+         }
+         freeBuffers[sizeClass].push_back(buffer);
+         cachedBytes += bytes;
+      }
+
+      /** Return all cached buffers to the system.*/
+      void release() {
+         for (unsigned int c=0; c<N_BLOCK_SIZE_CLASSES; ++c) {
+            for (size_t b=0; b<freeBuffers[c].size(); ++b) aligned_free(freeBuffers[c][b]);
+            std::vector<char*>().swap(freeBuffers[c]);
+         }
+         cachedBytes = 0;
+      }
+
+      static char* allocateNew(const unsigned int& sizeClass) {
+         char* buffer = static_cast<char*>(aligned_malloc(blockSizeClassCapacity(sizeClass)*BYTES_PER_BLOCK,WID3));
+         if (buffer == NULL) throw std::bad_alloc();
+         return buffer;
+      }
+
+    private:
+      std::vector<char*> freeBuffers[N_BLOCK_SIZE_CLASSES];
+      size_t cachedBytes;
+      bool& destroyed;
+   };
+
+   /** Pool of the calling thread, or NULL if it has already been destroyed at thread exit.*/
+   inline BlockBufferPool* threadBlockBufferPool() {
+      static thread_local bool destroyed = false;
+      static thread_local BlockBufferPool pool(destroyed);
+      if (destroyed) return NULL;
+      return &pool;
+   }
+
+   /** Free the block buffers cached by the calling thread.*/
+   inline void releaseBlockBufferPool() {
+      BlockBufferPool* pool = threadBlockBufferPool();
+      if (pool != NULL) pool->release();
+   }
+
    template<typename LID>
    class VelocityBlockContainer {
     public:
 
       VelocityBlockContainer();
+      VelocityBlockContainer(const VelocityBlockContainer& other);
+      ~VelocityBlockContainer();
+      VelocityBlockContainer& operator=(const VelocityBlockContainer& other);
       LID capacity() const;
       size_t capacityInBytes() const;
       void clear();
@@ -51,41 +167,105 @@ namespace vmesh {
       Realf* getData(const LID& blockLID);
       const Realf* getData(const LID& blockLID) const;
       Realf* getNullData();
+      #ifndef DERIVED_BLOCK_PARAMETERS
       Real* getParameters();
       const Real* getParameters() const;
       Real* getParameters(const LID& blockLID);      
       const Real* getParameters(const LID& blockLID) const;
+      #endif
       void pop();
       LID push_back();
       LID push_back(const uint32_t& N_blocks);
       bool recapacitate(const LID& capacity);
       bool setSize(const LID& newSize);
+      void makeShareable();
       LID size() const;
       size_t sizeInBytes() const;
       void swap(VelocityBlockContainer& vbc);
 
       #ifdef DEBUG_VBC
       const Realf& getData(const LID& blockLID,const unsigned int& cell) const;
+      #ifndef DERIVED_BLOCK_PARAMETERS
       const Real& getParameters(const LID& blockLID,const unsigned int& i) const;
+      #endif
       void setData(const LID& blockLID,const unsigned int& cell,const Realf& value);
       #endif
 
     private:
       void exitInvalidLocalID(const LID& localID,const std::string& funcName) const;
+      void reallocate(const size_t& newCapacity);
       void resize();
-      
-      std::vector<Realf,aligned_allocator<Realf,WID3> > block_data;
+      void unshare();
+
+      char* buffer;                 /**< Pooled memory holding block_data followed by parameters.*/
+      unsigned int sizeClass;       /**< Size class of buffer.*/
+      std::atomic<int>* sharedCount; /**< Number of containers sharing buffer, NULL if this container is its only owner.*/
+      Realf* block_data;
       Realf null_block_data[WID3];
       LID currentCapacity;
       LID numberOfBlocks;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters;
+      Real* parameters;
    };
    
    template<typename LID> inline
    VelocityBlockContainer<LID>::VelocityBlockContainer() {
+      buffer = NULL;
+      sizeClass = 0;
+      sharedCount = NULL;
+      block_data = NULL;
+      parameters = NULL;
       currentCapacity = 0;
       numberOfBlocks = 0;
    }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::VelocityBlockContainer(const VelocityBlockContainer& other) {
+      buffer = NULL;
+      sizeClass = 0;
+      sharedCount = NULL;
+      block_data = NULL;
+      parameters = NULL;
+      currentCapacity = 0;
+      numberOfBlocks = 0;
+      *this = other;
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::~VelocityBlockContainer() {
+      clear();
+   }
+
+   /** Copies the existing blocks of the other container, the capacity is
+    * the same as in the other container. If the other container is shareable,
+    * see makeShareable, its blocks are shared instead of copied.*/
+   template<typename LID> inline
+   VelocityBlockContainer<LID>& VelocityBlockContainer<LID>::operator=(const VelocityBlockContainer& other) {
+      if (this == &other) return *this;
+      if (other.sharedCount != NULL) {
+         if (buffer != other.buffer) {
+            clear();
+            other.sharedCount->fetch_add(1);
+            buffer = other.buffer;
+            sizeClass = other.sizeClass;
+            sharedCount = other.sharedCount;
+            block_data = other.block_data;
+            parameters = other.parameters;
+            currentCapacity = other.currentCapacity;
+         }
+         numberOfBlocks = other.numberOfBlocks;
+         return *this;
+      }
+      if (sharedCount != NULL) clear();
+      numberOfBlocks = 0;
+      if (other.currentCapacity == 0) clear();
+      else if (other.currentCapacity != currentCapacity) reallocate(other.currentCapacity);
+      numberOfBlocks = other.numberOfBlocks;
+      if (numberOfBlocks > 0) {
+         std::memcpy(block_data,other.block_data,numberOfBlocks*WID3*sizeof(Realf));
+         std::memcpy(parameters,other.parameters,numberOfBlocks*N_STORED_BLOCK_PARAMS*sizeof(Real));
+      }
+      return *this;
+   }
    
    template<typename LID> inline
    LID VelocityBlockContainer<LID>::capacity() const {
@@ -94,19 +274,29 @@ namespace vmesh {
    
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::capacityInBytes() const {
-      return (block_data.capacity())*sizeof(Realf) + parameters.capacity()*sizeof(Real);
+      return currentCapacity*BYTES_PER_BLOCK;
    }
 
-   /** Clears VelocityBlockContainer data and deallocates all memory 
-    * reserved for velocity blocks.*/
+   /** Clears VelocityBlockContainer data and returns the memory reserved
+    * for velocity blocks to the block buffer pool of the calling thread,
+    * unless other containers still share it.*/
    template<typename LID> inline
    void VelocityBlockContainer<LID>::clear() {
-      std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > dummy_parameters;
-      
-      block_data.swap(dummy_data);
-      parameters.swap(dummy_parameters);
-      
+      bool lastOwner = true;
+      if (sharedCount != NULL) {
+         lastOwner = sharedCount->fetch_sub(1) == 1;
+         if (lastOwner) delete sharedCount;
+      }
+      if (buffer != NULL && lastOwner) {
+         BlockBufferPool* pool = threadBlockBufferPool();
+         if (pool != NULL) pool->deallocate(buffer,sizeClass);
+         else aligned_free(buffer);
+      }
+      buffer = NULL;
+      sizeClass = 0;
+      sharedCount = NULL;
+      block_data = NULL;
+      parameters = NULL;
       currentCapacity = 0;
       numberOfBlocks = 0;
    }
@@ -121,23 +311,19 @@ namespace vmesh {
          if (target >= currentCapacity) ok = false;
          if (numberOfBlocks >= currentCapacity) ok = false;
          if (source != numberOfBlocks-1) ok = false;
-         if (source*WID3+WID3-1 >= block_data.size()) ok = false;
-         if (source*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (target*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS != block_data.size()/WID3) ok = false;
          if (ok == false) {
             std::stringstream ss;
             ss << "VBC ERROR: invalid source LID=" << source << " in copy, target=" << target << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
-            ss << "or sizes are wrong, data.size()=" << block_data.size() << " parameters.size()=" << parameters.size() << std::endl;
             std::cerr << ss.str();
             sleep(1);
             exit(1);
          }
       #endif
 
+      if (sharedCount != NULL) unshare();
       for (unsigned int i=0; i<WID3; ++i) block_data[target*WID3+i] = block_data[source*WID3+i];
-      for (int i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) {
-         parameters[target*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = parameters[source*BlockParams::N_VELOCITY_BLOCK_PARAMS+i];
+      for (int i=0; i<N_STORED_BLOCK_PARAMS; ++i) {
+         parameters[target*N_STORED_BLOCK_PARAMS+i] = parameters[source*N_STORED_BLOCK_PARAMS+i];
       }
    }
 
@@ -161,30 +347,32 @@ namespace vmesh {
    
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData() {
-      return block_data.data();
+      if (sharedCount != NULL) unshare();
+      return block_data;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData() const {
-      return block_data.data();
+      return block_data;
    }
 
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getData");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      if (sharedCount != NULL) unshare();
+      return block_data + blockLID*WID3;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getData const");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      return block_data + blockLID*WID3;
    }
 
    template<typename LID> inline
@@ -192,50 +380,65 @@ namespace vmesh {
        return null_block_data;
    }
 
+   #ifndef DERIVED_BLOCK_PARAMETERS
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters() {
-      return parameters.data();
+      if (sharedCount != NULL) unshare();
+      return parameters;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters() const {
-      return parameters.data();
+      return parameters;
    }
 
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getParameters");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      if (sharedCount != NULL) unshare();
+      return parameters + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getParameters const");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      return parameters + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
    }
-   
+   #endif
+
    template<typename LID> inline
    void VelocityBlockContainer<LID>::pop() {
       if (numberOfBlocks == 0) return;
       --numberOfBlocks;
    }
 
+   /** Allow copies of this container to share its blocks instead of copying them.
+    * A container that shares its blocks with others takes a copy of its own when it
+    * is modified or its blocks are accessed through the non-const member functions,
+    * so read-only users should access them through a const reference. As with any
+    * modification, this must not happen concurrently with other uses of the container.*/
+   template<typename LID> inline
+   void VelocityBlockContainer<LID>::makeShareable() {
+      if (buffer != NULL && sharedCount == NULL) sharedCount = new std::atomic<int>(1);
+   }
+
    template<typename LID> inline
    LID VelocityBlockContainer<LID>::push_back() {
+      if (sharedCount != NULL) unshare();
       LID newIndex = numberOfBlocks;
       if (newIndex >= currentCapacity) resize();
 
       #ifdef DEBUG_VBC
-      if (newIndex >= block_data.size()/WID3 || newIndex >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) {
+      if (newIndex >= currentCapacity) {
          std::stringstream ss;
          ss << "VBC ERROR in push_back, LID=" << newIndex << " for new block is out of bounds" << std::endl;
-         ss << "\t data.size()=" << block_data.size()  << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "\t capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -244,8 +447,8 @@ namespace vmesh {
 
       // Clear velocity block data to zero values
       for (size_t i=0; i<WID3; ++i) block_data[newIndex*WID3+i] = 0.0;
-      for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) 
-         parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+      for (size_t i=0; i<N_STORED_BLOCK_PARAMS; ++i) 
+         parameters[newIndex*N_STORED_BLOCK_PARAMS+i] = 0.0;
 
       ++numberOfBlocks;
       return newIndex;
@@ -253,14 +456,15 @@ namespace vmesh {
    
    template<typename LID> inline
    LID VelocityBlockContainer<LID>::push_back(const uint32_t& N_blocks) {
+      if (sharedCount != NULL) unshare();
       const LID newIndex = numberOfBlocks;
       numberOfBlocks += N_blocks;
       resize();
       
       // Clear velocity block data to zero values
       for (size_t i=0; i<WID3*N_blocks; ++i) block_data[newIndex*WID3+i] = 0.0;
-      for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS*N_blocks; ++i)
-	parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+      for (size_t i=0; i<N_STORED_BLOCK_PARAMS*N_blocks; ++i)
+	parameters[newIndex*N_STORED_BLOCK_PARAMS+i] = 0.0;
 
       return newIndex;
    }
@@ -268,29 +472,68 @@ namespace vmesh {
    template<typename LID> inline
    bool VelocityBlockContainer<LID>::recapacitate(const LID& newCapacity) {
       if (newCapacity < numberOfBlocks) return false;
-      {
-         std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data(newCapacity*WID3);
-         for (size_t i=0; i<numberOfBlocks*WID3; ++i) dummy_data[i] = block_data[i];
-         dummy_data.swap(block_data);
+      // Shrinking shared blocks would only make a copy of them
+      if (sharedCount != NULL && newCapacity <= currentCapacity) return true;
+      if (newCapacity == 0) clear();
+      else reallocate(newCapacity);
+      return true;
+   }
+
+   /** Move the existing blocks into a buffer of the size class of newCapacity,
+    * taken from the block buffer pool of the calling thread. Only the existing
+    * blocks are copied, the rest of the new buffer is left uninitialized. The
+    * capacity becomes the full capacity of the size class.*/
+   template<typename LID> inline
+   void VelocityBlockContainer<LID>::reallocate(const size_t& newCapacity) {
+      unsigned int newSizeClass = blockSizeClass(newCapacity);
+      if (buffer != NULL && newSizeClass == sizeClass && sharedCount == NULL) {
+         currentCapacity = blockSizeClassCapacity(sizeClass);
+         return;
       }
-      {
-         std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > dummy_parameters(newCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
-         for (size_t i=0; i<numberOfBlocks*BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) dummy_parameters[i] = parameters[i];
-         dummy_parameters.swap(parameters);
+
+      BlockBufferPool* pool = threadBlockBufferPool();
+      char* newBuffer;
+      if (pool != NULL) newBuffer = pool->allocate(newSizeClass);
+      else newBuffer = BlockBufferPool::allocateNew(newSizeClass);
+      const size_t newCapacityOfClass = blockSizeClassCapacity(newSizeClass);
+      Realf* newData = reinterpret_cast<Realf*>(newBuffer);
+      Real* newParameters = reinterpret_cast<Real*>(newBuffer + newCapacityOfClass*WID3*sizeof(Realf));
+
+      const LID nCopied = std::min(numberOfBlocks,currentCapacity);
+      if (nCopied > 0) {
+         std::memcpy(newData,block_data,nCopied*WID3*sizeof(Realf));
+         std::memcpy(newParameters,parameters,nCopied*N_STORED_BLOCK_PARAMS*sizeof(Real));
       }
-      currentCapacity = newCapacity;
-      return true;
+
+      const LID nBlocks = numberOfBlocks;
+      clear();
+      buffer = newBuffer;
+      sizeClass = newSizeClass;
+      block_data = newData;
+      parameters = newParameters;
+      currentCapacity = newCapacityOfClass;
+      numberOfBlocks = nBlocks;
    }
 
    template<typename LID> inline
    void VelocityBlockContainer<LID>::resize() {
       if ((numberOfBlocks+1) >= currentCapacity) {
-         // Resize so that free space is block_allocation_chunk blocks, 
+         // Resize so that free space is block_growth_factor-1 times the number of blocks,
          // and at least two in case of having zero blocks.
          // The order of velocity blocks is unaltered.
-         currentCapacity = 2 + numberOfBlocks * BLOCK_ALLOCATION_FACTOR;
-         block_data.resize(currentCapacity*WID3);
-         parameters.resize(currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+         reallocate(2 + numberOfBlocks * BLOCK_GROWTH_FACTOR);
+      }
+   }
+
+   /** Make this container the only owner of its blocks, copying them if they are
+    * still shared with other containers.*/
+   template<typename LID> inline
+   void VelocityBlockContainer<LID>::unshare() {
+      if (sharedCount->load() == 1) {
+         delete sharedCount;
+         sharedCount = NULL;
+      } else {
+         reallocate(currentCapacity);
       }
    }
 
@@ -310,13 +553,16 @@ namespace vmesh {
 
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::sizeInBytes() const {
-      return block_data.size()*sizeof(Realf) + parameters.size()*sizeof(Real);
+      return numberOfBlocks*BYTES_PER_BLOCK;
    }
 
    template<typename LID> inline
    void VelocityBlockContainer<LID>::swap(VelocityBlockContainer& vbc) {
-      block_data.swap(vbc.block_data);
-      parameters.swap(vbc.parameters);
+      std::swap(buffer,vbc.buffer);
+      std::swap(sizeClass,vbc.sizeClass);
+      std::swap(sharedCount,vbc.sharedCount);
+      std::swap(block_data,vbc.block_data);
+      std::swap(parameters,vbc.parameters);
 
       LID dummy = currentCapacity;
       currentCapacity = vbc.currentCapacity;
@@ -334,10 +580,10 @@ namespace vmesh {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -346,15 +592,16 @@ namespace vmesh {
       return block_data[blockLID*WID3+cell];
    }
 
+   #ifndef DERIVED_BLOCK_PARAMETERS
    template<typename LID> inline
    const Real& VelocityBlockContainer<LID>::getParameters(const LID& blockLID,const unsigned int& cell) const {
       bool ok = true;
       if (cell >= BlockParams::N_VELOCITY_BLOCK_PARAMS) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell >= parameters.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -362,21 +609,23 @@ namespace vmesh {
       
       return parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell];
    }
-   
+   #endif
+
    template<typename LID> inline
    void VelocityBlockContainer<LID>::setData(const LID& blockLID,const unsigned int& cell,const Realf& value) {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
       }
       
+      if (sharedCount != NULL) unshare();
       block_data[blockLID*WID3+cell] = value;
    }
    
@@ -0,0 +1,236 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef VELOCITY_MESH_HASHMAP_H
+#define VELOCITY_MESH_HASHMAP_H
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace vmesh {
+
+   /** Hash map from velocity block global IDs to local IDs, stored in a single
+    * power-of-two sized array of (key,value) pairs with linear probing. Erasing uses
+    * backward shifting, so there are no tombstones and lookups never slow down
+    * as blocks are created and removed.
+    *
+    * The interface is the subset of std::unordered_map used by VelocityMesh.
+    * The key emptyKey (INVALID_GLOBALID in VelocityMesh) cannot be stored. Iterators
+    * and pointers to values are invalidated by insertions and erasures.*/
+   template<typename GID,typename LID,GID emptyKey=std::numeric_limits<GID>::max()>
+   class HashMap {
+    public:
+      typedef GID key_type;
+      typedef LID mapped_type;
+      typedef std::pair<GID,LID> value_type;
+
+      template<typename Value,typename Map>
+      class Iterator {
+       public:
+         typedef std::forward_iterator_tag iterator_category;
+         typedef std::ptrdiff_t difference_type;
+         typedef Value value_type;
+         typedef Value* pointer;
+         typedef Value& reference;
+
+         Iterator(Map* map,size_t bucket): map(map),bucket(bucket) {
+            skipEmpty();
+         }
+         Value& operator*() const {return map->buckets[bucket];}
+         Value* operator->() const {return &(map->buckets[bucket]);}
+         Iterator& operator++() {++bucket; skipEmpty(); return *this;}
+         bool operator==(const Iterator& other) const {return bucket == other.bucket;}
+         bool operator!=(const Iterator& other) const {return bucket != other.bucket;}
+         size_t getBucket() const {return bucket;}
+
+       private:
+         void skipEmpty() {
+            while (bucket < map->buckets.size() && map->buckets[bucket].first == emptyKey) ++bucket;
+         }
+
+         Map* map;
+         size_t bucket;
+      };
+
+      typedef Iterator<value_type,HashMap> iterator;
+      typedef Iterator<const value_type,const HashMap> const_iterator;
+
+      HashMap(): nElements(0),sizePower(0) { }
+
+      iterator begin() {return iterator(this,0);}
+      const_iterator begin() const {return const_iterator(this,0);}
+      iterator end() {return iterator(this,buckets.size());}
+      const_iterator end() const {return const_iterator(this,buckets.size());}
+
+      size_t bucket_count() const {return buckets.size();}
+      bool empty() const {return nElements == 0;}
+      size_t size() const {return nElements;}
+
+      LID& at(const GID& key);
+      const LID& at(const GID& key) const;
+      void clear();
+      size_t count(const GID& key) const {return findBucket(key) == buckets.size() ? 0 : 1;}
+      void erase(const_iterator position) {eraseBucket(position.getBucket());}
+      void erase(iterator position) {eraseBucket(position.getBucket());}
+      size_t erase(const GID& key);
+      iterator find(const GID& key) {return iterator(this,findBucket(key));}
+      const_iterator find(const GID& key) const {return const_iterator(this,findBucket(key));}
+      std::pair<iterator,bool> insert(const value_type& element);
+      void reserve(const size_t& n);
+      void swap(HashMap& other);
+
+    private:
+      size_t bucketOf(const GID& key) const;
+      size_t findBucket(const GID& key) const;
+      void eraseBucket(size_t bucket);
+      void rehash(const int& newSizePower);
+
+      std::vector<value_type> buckets;     /**< Power-of-two number of buckets, empty buckets have key emptyKey.*/
+      size_t nElements;                    /**< Number of used buckets.*/
+      int sizePower;                       /**< buckets.size() == 2^sizePower, or 0 if there are no buckets.*/
+   };
+
+   /** Fibonacci hashing. Consecutive global IDs, i.e. neighboring blocks along vx,
+    * are spread evenly over the table.*/
+   template<typename GID,typename LID,GID emptyKey> inline
+   size_t HashMap<GID,LID,emptyKey>::bucketOf(const GID& key) const {
+      return (static_cast<uint64_t>(key) * UINT64_C(11400714819323198485)) >> (64 - sizePower);
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   size_t HashMap<GID,LID,emptyKey>::findBucket(const GID& key) const {
+      if (nElements == 0 || key == emptyKey) return buckets.size();
+
+      const size_t mask = buckets.size()-1;
+      size_t bucket = bucketOf(key);
+      while (true) {
+         const GID& bucketKey = buckets[bucket].first;
+         if (bucketKey == key) return bucket;
+         if (bucketKey == emptyKey) return buckets.size();
+         bucket = (bucket+1) & mask;
+      }
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   LID& HashMap<GID,LID,emptyKey>::at(const GID& key) {
+      const size_t bucket = findBucket(key);
+      if (bucket == buckets.size()) throw std::out_of_range("vmesh::HashMap::at");
+      return buckets[bucket].second;
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   const LID& HashMap<GID,LID,emptyKey>::at(const GID& key) const {
+      const size_t bucket = findBucket(key);
+      if (bucket == buckets.size()) throw std::out_of_range("vmesh::HashMap::at");
+      return buckets[bucket].second;
+   }
+
+   /** Remove all elements and deallocate the buckets.*/
+   template<typename GID,typename LID,GID emptyKey> inline
+   void HashMap<GID,LID,emptyKey>::clear() {
+      std::vector<value_type>().swap(buckets);
+      nElements = 0;
+      sizePower = 0;
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   size_t HashMap<GID,LID,emptyKey>::erase(const GID& key) {
+      const size_t bucket = findBucket(key);
+      if (bucket == buckets.size()) return 0;
+      eraseBucket(bucket);
+      return 1;
+   }
+
+   /** Empty the given bucket and shift the following elements of the same probe
+    * sequence backwards, so that every element stays reachable from its home bucket.*/
+   template<typename GID,typename LID,GID emptyKey> inline
+   void HashMap<GID,LID,emptyKey>::eraseBucket(size_t bucket) {
+      const size_t mask = buckets.size()-1;
+      size_t next = (bucket+1) & mask;
+      while (buckets[next].first != emptyKey) {
+         const size_t home = bucketOf(buckets[next].first);
+         // Move the element at next into the hole if its home bucket is not cyclically in (bucket,next]
+         if (((next - home) & mask) >= ((next - bucket) & mask)) {
+            buckets[bucket] = buckets[next];
+            bucket = next;
+         }
+         next = (next+1) & mask;
+      }
+      buckets[bucket].first = emptyKey;
+      --nElements;
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   std::pair<typename HashMap<GID,LID,emptyKey>::iterator,bool> HashMap<GID,LID,emptyKey>::insert(const value_type& element) {
+      // Keep the load factor at or below 1/2
+      if (2*(nElements+1) > buckets.size()) rehash(sizePower == 0 ? 4 : sizePower+1);
+
+      const size_t mask = buckets.size()-1;
+      size_t bucket = bucketOf(element.first);
+      while (true) {
+         if (buckets[bucket].first == element.first) return std::make_pair(iterator(this,bucket),false);
+         if (buckets[bucket].first == emptyKey) break;
+         bucket = (bucket+1) & mask;
+      }
+      buckets[bucket] = element;
+      ++nElements;
+      return std::make_pair(iterator(this,bucket),true);
+   }
+
+   /** Make room for n elements without rehashing.*/
+   template<typename GID,typename LID,GID emptyKey> inline
+   void HashMap<GID,LID,emptyKey>::reserve(const size_t& n) {
+      int newSizePower = 4;
+      while ((size_t(1) << newSizePower) < 2*n) ++newSizePower;
+      if (newSizePower > sizePower) rehash(newSizePower);
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   void HashMap<GID,LID,emptyKey>::rehash(const int& newSizePower) {
+      std::vector<value_type> oldBuckets(size_t(1) << newSizePower,std::make_pair(emptyKey,LID()));
+      oldBuckets.swap(buckets);
+      sizePower = newSizePower;
+
+      const size_t mask = buckets.size()-1;
+      for (size_t i=0; i<oldBuckets.size(); ++i) {
+         if (oldBuckets[i].first == emptyKey) continue;
+         size_t bucket = bucketOf(oldBuckets[i].first);
+         while (buckets[bucket].first != emptyKey) bucket = (bucket+1) & mask;
+         buckets[bucket] = oldBuckets[i];
+      }
+   }
+
+   template<typename GID,typename LID,GID emptyKey> inline
+   void HashMap<GID,LID,emptyKey>::swap(HashMap& other) {
+      buckets.swap(other.buckets);
+      std::swap(nElements,other.nElements);
+      std::swap(sizePower,other.sizePower);
+   }
+
+} // namespace vmesh
+
+#endif
@@ -23,8 +23,10 @@
 #ifndef VELOCITY_MESH_OLD_H
 #define VELOCITY_MESH_OLD_H
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <stdint.h>
 #include <vector>
 #include <unordered_map>
@@ -32,6 +34,7 @@
 #include <cmath>
 
 #include "velocity_mesh_parameters.h"
+#include "velocity_mesh_hashmap.h"
 
 namespace vmesh {
 
@@ -50,6 +53,7 @@ namespace vmesh {
       GID findBlockDown(uint8_t& refLevel,GID cellIndices[3]) const;
       GID findBlock(uint8_t& refLevel,GID cellIndices[3]) const;
       bool getBlockCoordinates(const GID& globalID,Real coords[3]) const;
+      bool getBlockIndexBounds(LID minIndices[3],LID maxIndices[3]) const;
       void getBlockInfo(const GID& globalID,Real* array) const;
       const Real* getBlockSize(const uint8_t& refLevel) const;
       bool getBlockSize(const GID& globalID,Real size[3]) const;
@@ -100,13 +104,30 @@ namespace vmesh {
       size_t size() const;
       size_t sizeInBytes() const;
       void swap(VelocityMesh& vm);
+      void updateBlockIndexBounds();
 
     private:
+      void clearLocalIDs();
+      void eraseLocalID(const GID& globalID);
+      LID findLocalID(const GID& globalID) const;
+      bool insertLocalID(const GID& globalID,const LID& localID);
+      void setLocalID(const GID& globalID,const LID& localID);
+
+      /** Meshes with MeshParameters::denseLocalIDs set and at most this many blocks store local IDs
+       * in an array indexed by global ID. The array costs sizeof(LID)*max_velocity_blocks bytes per
+       * mesh with blocks, up to 128 KiB at this limit, in every cell and remote copy of the population.
+       * That is more than the block data of sparse cells, hence the array is opt-in.*/
+      static const GID maxDenseBlocks = 32768;
+
       static std::vector<vmesh::MeshParameters> meshParameters;
       size_t meshID;
+      bool dense;                                /**< If true, globalToLocalArray is used instead of globalToLocalMap.*/
 
       std::vector<GID> localToGlobalMap;
-      std::unordered_map<GID,LID> globalToLocalMap;
+      vmesh::HashMap<GID,LID> globalToLocalMap;
+      std::vector<LID> globalToLocalArray;       /**< Local ID of each global ID, allocated when the first block is added.*/
+      LID boundsMin[3];                          /**< Smallest block indices of existing blocks, see getBlockIndexBounds.*/
+      LID boundsMax[3];                          /**< Largest block indices of existing blocks, see getBlockIndexBounds.*/
    };
 
    // ***** INITIALIZERS FOR STATIC MEMBER VARIABLES ***** //
@@ -117,6 +138,11 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    VelocityMesh<GID,LID>::VelocityMesh() { 
       meshID = std::numeric_limits<size_t>::max();
+      dense = false;
+      for (int i=0; i<3; ++i) {
+         boundsMin[i] = invalidBlockIndex();
+         boundsMax[i] = 0;
+      }
    }
    
    template<typename GID,typename LID> inline
@@ -125,14 +151,15 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::capacityInBytes() const {
       return localToGlobalMap.capacity()*sizeof(GID)
-           + globalToLocalMap.bucket_count()*(sizeof(GID)+sizeof(LID));
+           + globalToLocalMap.bucket_count()*(sizeof(GID)+sizeof(LID))
+           + globalToLocalArray.capacity()*sizeof(LID);
    }
 
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::check() const {
       bool ok = true;
 
-      if (localToGlobalMap.size() != globalToLocalMap.size()) {
+      if (!dense && localToGlobalMap.size() != globalToLocalMap.size()) {
          std::cerr << "VMO ERROR: sizes differ, " << localToGlobalMap.size() << " vs " << globalToLocalMap.size() << std::endl;
          ok = false;
          exit(1);	 
@@ -140,8 +167,7 @@ namespace vmesh {
 
       for (size_t b=0; b<size(); ++b) {
          const LID globalID = localToGlobalMap[b];
-         typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
-         const GID localID = it->second;
+         const GID localID = findLocalID(globalID);
          if (localID != b) {
             ok = false;
             std::cerr << "VMO ERROR: localToGlobalMap[" << b << "] = " << globalID << " but ";
@@ -156,7 +182,26 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::clear() {
       std::vector<GID>().swap(localToGlobalMap);
-      std::unordered_map<GID,LID>().swap(globalToLocalMap);
+      globalToLocalMap.clear();
+      std::vector<LID>().swap(globalToLocalArray);
+      for (int i=0; i<3; ++i) {
+         boundsMin[i] = invalidBlockIndex();
+         boundsMax[i] = 0;
+      }
+   }
+   
+   /** Remove all global to local ID mappings, keeping the allocated storage.*/
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::clearLocalIDs() {
+      if (dense) {
+         std::fill(globalToLocalArray.begin(),globalToLocalArray.end(),invalidLocalID());
+      } else {
+         globalToLocalMap.clear();
+      }
+      for (int i=0; i<3; ++i) {
+         boundsMin[i] = invalidBlockIndex();
+         boundsMax[i] = 0;
+      }
    }
    
    template<typename GID,typename LID> inline
@@ -169,17 +214,26 @@ namespace vmesh {
       const GID sourceGID = localToGlobalMap[sourceLID]; // block at the end of list
       const GID targetGID = localToGlobalMap[targetLID]; // removed block
 
-      // at-function will throw out_of_range exception for non-existing global ID:
-      globalToLocalMap.at(sourceGID) = targetLID;
+      // setLocalID will throw out_of_range exception for non-existing global ID:
+      setLocalID(sourceGID,targetLID);
       localToGlobalMap[targetLID]    = sourceGID;
-      globalToLocalMap.at(targetGID) = sourceLID; // These are needed to make pop() work
+      setLocalID(targetGID,sourceLID); // These are needed to make pop() work
       localToGlobalMap[sourceLID]    = targetGID;
       return true;
    }
    
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::count(const GID& globalID) const {
-      return globalToLocalMap.count(globalID);
+      return findLocalID(globalID) == invalidLocalID() ? 0 : 1;
+   }
+   
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::eraseLocalID(const GID& globalID) {
+      if (dense) {
+         globalToLocalArray[globalID] = invalidLocalID();
+      } else {
+         globalToLocalMap.erase(globalToLocalMap.find(globalID));
+      }
    }
    
    template<typename GID,typename LID> inline
@@ -193,7 +247,7 @@ namespace vmesh {
       GID blockGID = getGlobalID(0,i_block,j_block,k_block);
       
       // If the block exists, return it:
-      if (globalToLocalMap.find(blockGID) != globalToLocalMap.end()) {
+      if (findLocalID(blockGID) != invalidLocalID()) {
          return blockGID;
       } else {
          return invalidGlobalID();
@@ -242,6 +296,21 @@ namespace vmesh {
       return true;
    }
    
+   /** Get the bounding box of the existing blocks in block indices. The box grows as
+    * blocks are added but does not shrink when they are removed, so it may be larger
+    * than the existing blocks until updateBlockIndexBounds is called.
+    * @param minIndices Smallest i,j,k block indices.
+    * @param maxIndices Largest i,j,k block indices.
+    * @return If false, the mesh has no blocks and the indices are not valid.*/
+   template<typename GID,typename LID> inline
+   bool VelocityMesh<GID,LID>::getBlockIndexBounds(LID minIndices[3],LID maxIndices[3]) const {
+      for (int i=0; i<3; ++i) {
+         minIndices[i] = boundsMin[i];
+         maxIndices[i] = boundsMax[i];
+      }
+      return boundsMin[0] <= boundsMax[0];
+   }
+
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::getBlockInfo(const GID& globalID,Real* array) const {
       #ifndef NDEBUG
@@ -375,11 +444,21 @@ namespace vmesh {
    }
 
    template<typename GID,typename LID> inline
-   LID VelocityMesh<GID,LID>::getLocalID(const GID& globalID) const {
-      typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
+   LID VelocityMesh<GID,LID>::findLocalID(const GID& globalID) const {
+      if (dense) {
+         // The array is empty until the first block is added
+         if (globalID < globalToLocalArray.size()) return globalToLocalArray[globalID];
+         return invalidLocalID();
+      }
+      typename vmesh::HashMap<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
       if (it != globalToLocalMap.end()) return it->second;
       return invalidLocalID();
    }
+
+   template<typename GID,typename LID> inline
+   LID VelocityMesh<GID,LID>::getLocalID(const GID& globalID) const {
+      return findLocalID(globalID);
+   }
    
    template<typename GID,typename LID> inline
    uint8_t VelocityMesh<GID,LID>::getMaxAllowedRefinementLevel() const {
@@ -448,13 +527,12 @@ namespace vmesh {
       getIndices(globalID,refLevel,i,j,k);
       
       // Return the requested neighbor if it exists:
-      typename std::unordered_map<GID,LID>::const_iterator nbr;
       GID nbrGlobalID = getGlobalID(0,i+i_off,j+j_off,k+k_off);
       if (nbrGlobalID == invalidGlobalID()) return;
 
-      nbr = globalToLocalMap.find(nbrGlobalID);
-      if (nbr != globalToLocalMap.end()) {
-         neighborLocalIDs.push_back(nbr->second);
+      const LID nbrLocalID = findLocalID(nbrGlobalID);
+      if (nbrLocalID != invalidLocalID()) {
+         neighborLocalIDs.push_back(nbrLocalID);
          refLevelDifference = 0;
          return;
       }
@@ -518,6 +596,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::initialize(const size_t& meshID) {
       this->meshID = meshID;
+      dense = meshParameters[meshID].denseLocalIDs;
       return true;
    }
    
@@ -549,6 +628,8 @@ namespace vmesh {
               = meshParameters[meshID].gridLength[0]
               * meshParameters[meshID].gridLength[1]
               * meshParameters[meshID].gridLength[2];
+      meshParameters[meshID].denseLocalIDs = meshParameters[meshID].denseLocalIDs
+                                          && meshParameters[meshID].max_velocity_blocks <= maxDenseBlocks;
       meshParameters[meshID].initialized = true;
 
       vmesh::VelocityMesh<GID,LID>::meshParameters = meshParameters;
@@ -570,6 +651,32 @@ namespace vmesh {
       return INVALID_LOCALID;
    }
    
+   /** Add a global to local ID mapping, unless the global ID already has one.
+    * @return If true, the mapping was added.*/
+   template<typename GID,typename LID> inline
+   bool VelocityMesh<GID,LID>::insertLocalID(const GID& globalID,const LID& localID) {
+      if (dense) {
+         if (globalToLocalArray.size() == 0) {
+            globalToLocalArray.assign(meshParameters[meshID].max_velocity_blocks,invalidLocalID());
+         }
+         if (globalID >= globalToLocalArray.size()) return false;
+         if (globalToLocalArray[globalID] != invalidLocalID()) return false;
+         globalToLocalArray[globalID] = localID;
+      } else {
+         if (globalToLocalMap.insert(std::make_pair(globalID,localID)).second == false) return false;
+      }
+
+      // Grow the bounding box of existing blocks
+      uint8_t refLevel;
+      LID indices[3];
+      getIndices(globalID,refLevel,indices[0],indices[1],indices[2]);
+      for (int i=0; i<3; ++i) {
+         boundsMin[i] = std::min(boundsMin[i],indices[i]);
+         boundsMax[i] = std::max(boundsMax[i],indices[i]);
+      }
+      return true;
+   }
+
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::isInitialized() const {
       return meshParameters[meshID].initialized;
@@ -581,9 +688,8 @@ namespace vmesh {
 
       const LID lastLID = size()-1;
       const GID lastGID = localToGlobalMap[lastLID];
-      typename std::unordered_map<GID,LID>::iterator last = globalToLocalMap.find(lastGID);
 
-      globalToLocalMap.erase(last);
+      eraseLocalID(lastGID);
       localToGlobalMap.pop_back();
    }
 
@@ -592,14 +698,13 @@ namespace vmesh {
       if (size() >= meshParameters[meshID].max_velocity_blocks) return false;
       if (globalID == invalidGlobalID()) return false;
 
-      std::pair<typename std::unordered_map<GID,LID>::iterator,bool> position
-        = globalToLocalMap.insert(std::make_pair(globalID,localToGlobalMap.size()));
+      const bool inserted = insertLocalID(globalID,localToGlobalMap.size());
 
-      if (position.second == true) {
+      if (inserted == true) {
          localToGlobalMap.push_back(globalID);
       }
 
-      return position.second;
+      return inserted;
    }
 
    template<typename GID,typename LID> inline
@@ -612,7 +717,7 @@ namespace vmesh {
       }
          
       for (size_t b=0; b<blocks.size(); ++b) {
-         globalToLocalMap.insert(std::make_pair(blocks[b],localToGlobalMap.size()+b));
+         insertLocalID(blocks[b],localToGlobalMap.size()+b);
       }
       localToGlobalMap.insert(localToGlobalMap.end(),blocks.begin(),blocks.end());
 
@@ -626,17 +731,17 @@ namespace vmesh {
 
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::setGrid() {
-      globalToLocalMap.clear();
+      clearLocalIDs();
       for (size_t i=0; i<localToGlobalMap.size(); ++i) {
-         globalToLocalMap.insert(std::make_pair(localToGlobalMap[i],i));
+         insertLocalID(localToGlobalMap[i],i);
       }
    }
 
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::setGrid(const std::vector<GID>& globalIDs) {
-      globalToLocalMap.clear();
+      clearLocalIDs();
       for (LID i=0; i<globalIDs.size(); ++i) {
-         globalToLocalMap.insert(std::make_pair(globalIDs[i],i));
+         insertLocalID(globalIDs[i],i);
       }
       localToGlobalMap = globalIDs;
       return true;
@@ -646,9 +751,23 @@ namespace vmesh {
    bool VelocityMesh<GID,LID>::setMesh(const size_t& meshID) {
       if (meshID >= meshParameters.size()) return false;
       this->meshID = meshID;
+      dense = meshParameters[meshID].denseLocalIDs;
       return true;
    }
    
+   /** Change the local ID of an existing global ID.*/
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::setLocalID(const GID& globalID,const LID& localID) {
+      if (dense) {
+         if (globalID >= globalToLocalArray.size() || globalToLocalArray[globalID] == invalidLocalID()) {
+            throw std::out_of_range("VelocityMesh::setLocalID");
+         }
+         globalToLocalArray[globalID] = localID;
+      } else {
+         globalToLocalMap.at(globalID) = localID;
+      }
+   }
+   
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::setNewSize(const LID& newSize) {
       localToGlobalMap.resize(newSize);
@@ -662,13 +781,41 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::sizeInBytes() const {
       return globalToLocalMap.size()*sizeof(GID)
-           + localToGlobalMap.size()*(sizeof(GID)+sizeof(LID));
+           + localToGlobalMap.size()*(sizeof(GID)+sizeof(LID))
+           + globalToLocalArray.size()*sizeof(LID);
    }
 
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::swap(VelocityMesh& vm) {
       globalToLocalMap.swap(vm.globalToLocalMap);
       localToGlobalMap.swap(vm.localToGlobalMap);
+      globalToLocalArray.swap(vm.globalToLocalArray);
+      std::swap(dense,vm.dense);
+      for (int i=0; i<3; ++i) {
+         std::swap(boundsMin[i],vm.boundsMin[i]);
+         std::swap(boundsMax[i],vm.boundsMax[i]);
+      }
+   }
+
+   /** Shrink the bounding box returned by getBlockIndexBounds to the existing blocks.*/
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::updateBlockIndexBounds() {
+      for (int i=0; i<3; ++i) {
+         boundsMin[i] = invalidBlockIndex();
+         boundsMax[i] = 0;
+      }
+      const LID gridLength0 = meshParameters[meshID].gridLength[0];
+      const LID gridLength1 = meshParameters[meshID].gridLength[1];
+      for (size_t b=0; b<localToGlobalMap.size(); ++b) {
+         const GID globalID = localToGlobalMap[b];
+         const LID indices[3] = {globalID % gridLength0,
+                                 (globalID / gridLength0) % gridLength1,
+                                 globalID / (gridLength0 * gridLength1)};
+         for (int i=0; i<3; ++i) {
+            boundsMin[i] = std::min(boundsMin[i],indices[i]);
+            boundsMax[i] = std::max(boundsMax[i],indices[i]);
+         }
+      }
    }
    
 } // namespace vmesh
@@ -58,6 +58,9 @@ namespace vmesh {
       Real blockSize[3];                        /**< Size of a block at base grid level.*/
       Real cellSize[3];                         /**< Size of a cell in a block at base grid level.*/
       Real gridSize[3];                         /**< Physical size of the grid bounding box.*/
+      bool denseLocalIDs;                       /**< If true, block local IDs are looked up from an array
+                                                 * indexed by global ID instead of a hash map, see
+                                                 * VelocityMesh::maxDenseBlocks. Off by default.*/
 
       // ***** DERIVED PARAMETERS SPECIFIC TO AMR ***** //
       std::vector<vmesh::GlobalID> offsets;     /**< Block global ID offsets for each refinement level.*/
@@ -73,6 +76,7 @@ namespace vmesh {
 
       MeshParameters() {
          initialized = false;
+         denseLocalIDs = false;
       }
    };
 
@@ -113,8 +113,11 @@ bool computeNewTimeStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
    dtMaxLocal[1]=numeric_limits<Real>::max();
    dtMaxLocal[2]=numeric_limits<Real>::max();
 
-   for (vector<CellID>::const_iterator cell_id=cells.begin(); cell_id!=cells.end(); ++cell_id) {
-      SpatialCell* cell = mpiGrid[*cell_id];
+   Real dtMaxLocalR = dtMaxLocal[0];
+   Real dtMaxLocalV = dtMaxLocal[1];
+   #pragma omp parallel for reduction(min:dtMaxLocalR,dtMaxLocalV)
+   for (size_t c=0; c<cells.size(); ++c) {
+      SpatialCell* cell = mpiGrid[cells[c]];
       const Real dx = cell->parameters[CellParams::DX];
       const Real dy = cell->parameters[CellParams::DY];
       const Real dz = cell->parameters[CellParams::DZ];
@@ -123,9 +126,30 @@ bool computeNewTimeStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
       
       for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
          cell->set_max_r_dt(popID,numeric_limits<Real>::max());
+         const Real EPS = numeric_limits<Real>::min()*1000;
+         #ifndef AMR
+         // The fastest velocities are at the faces of the bounding box of the
+         // velocity blocks. As before, the velocities are taken at the centers
+         // of the first and last cells of the blocks.
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         vmesh::LocalID minIndices[3], maxIndices[3];
+         if (vmesh.getBlockIndexBounds(minIndices,maxIndices) == false) continue;
+         Real minCoords[3], maxCoords[3];
+         vmesh.getBlockCoordinates(vmesh.getGlobalID(0,minIndices[0],minIndices[1],minIndices[2]),minCoords);
+         vmesh.getBlockCoordinates(vmesh.getGlobalID(0,maxIndices[0],maxIndices[1],maxIndices[2]),maxCoords);
+         const Real* dv = vmesh.getCellSize(0);
+         const Real d[3] = {dx,dy,dz};
+         Real dt_max_cell = numeric_limits<Real>::max();
+         for (int i=0; i<3; ++i) {
+            const Real vMin = minCoords[i] + HALF*dv[i] + EPS;
+            const Real vMax = maxCoords[i] + (WID-1+HALF)*dv[i] + EPS;
+            dt_max_cell = min(dt_max_cell,min(d[i]/fabs(vMin),d[i]/fabs(vMax)));
+         }
+         cell->parameters[CellParams::MAXRDT] = min(dt_max_cell,cell->parameters[CellParams::MAXRDT]);
+         cell->set_max_r_dt(popID,dt_max_cell);
+         #else
          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
          const Real* blockParams = blockContainer.getParameters();
-         const Real EPS = numeric_limits<Real>::min()*1000;
          for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
             for (unsigned int i=0; i<WID;i+=WID-1) {
                 const Real Vx 
@@ -146,20 +170,23 @@ bool computeNewTimeStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
                 cell->set_max_r_dt(popID,min(dt_max_cell,cell->get_max_r_dt(popID)));
              }
          }
+         #endif
       }
       
       
       if ( cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY ||
            (cell->sysBoundaryLayer == 1 && cell->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY )) {
          //spatial fluxes computed also for boundary cells
-         dtMaxLocal[0]=min(dtMaxLocal[0], cell->parameters[CellParams::MAXRDT]);
+         dtMaxLocalR=min(dtMaxLocalR, cell->parameters[CellParams::MAXRDT]);
       }
 
       if (cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY && cell->parameters[CellParams::MAXVDT] != 0) {
          //Acceleration only done on non sysboundary cells
-         dtMaxLocal[1]=min(dtMaxLocal[1], cell->parameters[CellParams::MAXVDT]);
+         dtMaxLocalV=min(dtMaxLocalV, cell->parameters[CellParams::MAXVDT]);
       }
    }
+   dtMaxLocal[0] = dtMaxLocalR;
+   dtMaxLocal[1] = dtMaxLocalV;
    
    //compute max dt for fieldsolver
    const std::array<int, 3> gridDims(technicalGrid.getLocalSize());
@@ -602,12 +629,14 @@ int main(int argn,char* args[]) {
 
    // Invalidate cached cell lists just to be sure (might not be needed)
    P::meshRepartitioned = true;
+   P::meshRepartitionCount++;
 
    unsigned int wallTimeRestartCounter=1;
 
    int doNow[2]; // 0: writeRestartNow, 1: balanceLoadNow ; declared outside main loop
    int writeRestartNow; // declared outside main loop
    bool overrideRebalanceNow = false; // declared outside main loop
+   bool measuringForRebalance = false; // declared outside main loop
    
    addTimedBarrier("barrier-end-initialization");
    
@@ -791,6 +820,7 @@ int main(int argn,char* args[]) {
          phiprof::stop("Shrink_to_fit");
          logFile << "(LB): ... done!"  << endl << writeVerbose;
          P::prepareForRebalance = false;
+         measuringForRebalance = false;
 
          overrideRebalanceNow = false;
       }
@@ -834,12 +864,17 @@ int main(int argn,char* args[]) {
          }
       }
       
-      if (P::tstep % P::rebalanceInterval == P::rebalanceInterval-1 || P::prepareForRebalance == true) {
+      // Measure the cell times over the last measuredSteps steps before a scheduled rebalance,
+      // or over this step only if a rebalance was requested at run time.
+      const uint measuredSteps = max(1u, min(P::loadBalanceMeasuredSteps, P::rebalanceInterval));
+      if (!measuringForRebalance &&
+          (P::tstep % P::rebalanceInterval >= P::rebalanceInterval - measuredSteps || P::prepareForRebalance == true)) {
          if(P::prepareForRebalance == true) {
             overrideRebalanceNow = true;
          } else {
             P::prepareForRebalance = true;
          }
+         measuringForRebalance = true;
          #pragma omp parallel for
          for (size_t c=0; c<cells.size(); ++c) {
             mpiGrid[cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] = 0;
@@ -1010,6 +1045,7 @@ int main(int argn,char* args[]) {
    logFile.close();
    if (P::diagnosticInterval != 0) diagnostic.close();
    
+   freeCouplingPlan();
    perBGrid.finalize();
    perBDt2Grid.finalize();
    EGrid.finalize();
@@ -26,6 +26,7 @@
 #include <utility>
 
 #include "vec.h"
+#include "../memoryallocation.h"
 #include "cpu_acc_sort_blocks.hpp"
 #include "cpu_acc_load_blocks.hpp"
 #include "cpu_1d_pqm.hpp"
@@ -35,6 +36,35 @@
 
 using namespace std;
 using namespace spatial_cell;
+
+/*
+  Buffers used by map_1d. Each thread has its own workspace that is kept over
+  all cells and all three sweeps of cpu_accelerate_cell, so after the first
+  few cells the mapping does no heap allocations. The containers only grow.
+  The column structure is rebuilt by each sweep. The mesh is sorted along a
+  different dimension each time, and the previous sweep has added and removed
+  blocks, so the columns of the previous sweep cannot be reused.
+*/
+struct AccelerationWorkspace {
+   std::vector<vmesh::GlobalID> blocks;         /*!< Blocks sorted into columns along the dimension*/
+   ColumnSortBuffers sortBuffers;               /*!< Work arrays of sortBlocklistByDimension*/
+   std::vector<uint> columnBlockOffsets;        /*!< Offset of each column in blocks*/
+   std::vector<uint> columnNumBlocks;           /*!< Number of blocks in each column*/
+   std::vector<uint> setColumnOffsets;          /*!< Offset of the first column of each column set*/
+   std::vector<uint> setNumColumns;             /*!< Number of columns in each column set*/
+   std::vector<int> columnMinBlockK;            /*!< First target block of each column*/
+   std::vector<int> columnMaxBlockK;            /*!< Last target block of each column*/
+   /*
+     values array used to store column data The max size is the worst
+     case scenario with every second block having content, creating up
+     to ( MAX_BLOCKS_PER_DIM / 2 + 1) columns with each needing three
+     blocks (two for padding)
+   */
+   std::vector<Vec, aligned_allocator<Vec,WID3>> values;
+};
+
+static thread_local AccelerationWorkspace accelerationWorkspace;
+
 /** Attempt to add the given velocity block to the given velocity mesh.
  * If the block was added to the mesh, its data is set to zero values and 
  * velocity block parameters are calculated.
@@ -68,9 +98,11 @@ vmesh::LocalID addVelocityBlock(const vmesh::GlobalID& blockGID,
     #endif
     
     // Set block parameters:
+    #ifndef DERIVED_BLOCK_PARAMETERS
     Real* parameters = blockContainer.getParameters(newBlockLID);
     vmesh.getBlockCoordinates(blockGID,parameters+BlockParams::VXCRD);
     vmesh.getCellSize(blockGID,parameters+BlockParams::DVX);
+    #endif
     return newBlockLID;
 }
 
@@ -194,27 +226,28 @@ bool map_1d(SpatialCell* spatial_cell,
    const Realv i_dv=1.0/dv;
 
    // sort blocks according to dimension, and divide them into columns
-   vmesh::LocalID* blocks = new vmesh::LocalID[vmesh.size()];
-   std::vector<uint> columnBlockOffsets;
-   std::vector<uint> columnNumBlocks;
-   std::vector<uint> setColumnOffsets;
-   std::vector<uint> setNumColumns;
-   std::vector<int> columnMinBlockK;
-   std::vector<int> columnMaxBlockK;
+   AccelerationWorkspace& workspace = accelerationWorkspace;
+   workspace.blocks.resize(vmesh.size());
+   vmesh::GlobalID* blocks = workspace.blocks.data();
+   std::vector<uint>& columnBlockOffsets = workspace.columnBlockOffsets;
+   std::vector<uint>& columnNumBlocks = workspace.columnNumBlocks;
+   std::vector<uint>& setColumnOffsets = workspace.setColumnOffsets;
+   std::vector<uint>& setNumColumns = workspace.setNumColumns;
+   std::vector<int>& columnMinBlockK = workspace.columnMinBlockK;
+   std::vector<int>& columnMaxBlockK = workspace.columnMaxBlockK;
+   columnMinBlockK.clear();
+   columnMaxBlockK.clear();
    
-   sortBlocklistByDimension(vmesh, dimension, blocks,
+   sortBlocklistByDimension(vmesh, dimension, workspace.sortBuffers, blocks,
                             columnBlockOffsets, columnNumBlocks,
                             setColumnOffsets, setNumColumns);
    
    // loop over block column sets  (all columns along the dimension with the other dimensions being equal )
       
-/*   
-     values array used to store column data The max size is the worst
-     case scenario with every second block having content, creating up
-     to ( MAX_BLOCKS_PER_DIM / 2 + 1) columns with each needing three
-     blocks (two for padding)
-*/
-   Vec values[(3 * ( MAX_BLOCKS_PER_DIM / 2 + 1)) * WID3 / VECL];
+   if (workspace.values.size() == 0) {
+      workspace.values.resize((3 * ( MAX_BLOCKS_PER_DIM / 2 + 1)) * WID3 / VECL);
+   }
+   Vec* values = workspace.values.data();
    /*pointers to target block datas*/
    Realf *blockIndexToBlockData[MAX_BLOCKS_PER_DIM];
    bool isTargetBlock[MAX_BLOCKS_PER_DIM];
@@ -573,7 +606,6 @@ bool map_1d(SpatialCell* spatial_cell,
       } //for loop over columns
       
    }
-   delete [] blocks;
    return true;
 }
 
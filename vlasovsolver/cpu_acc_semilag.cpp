@@ -157,6 +157,7 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
    }
 
    if (Parameters::prepareForRebalance == true) {
-//       spatial_cell->parameters[CellParams::LBWEIGHTCOUNTER] += (MPI_Wtime() - t1);
+      // Each cell is accelerated by a single thread, so the counter can be updated directly
+      spatial_cell->parameters[CellParams::LBWEIGHTCOUNTER] += (MPI_Wtime() - t1);
    }
 }
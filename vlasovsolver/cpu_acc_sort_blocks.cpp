@@ -31,21 +31,31 @@
 using namespace std;
 using namespace spatial_cell;
 
-// Comparator function for sorting vector of pairs
-inline bool paircomparator( const std::pair<uint, uint> & l, const std::pair<uint, uint> & r ) {
-   return l.first < r.first;
-}
-
 /*
    This function returns a sorted list of blocks in a cell.
 
    The sorted list is sorted according to the location, along the given dimension.
+   Blocks are ordered by column (the block indices in the two other dimensions)
+   and within a column by their index along the dimension. Both are bounded by
+   the velocity grid lengths, so the list is sorted with two stable counting
+   sort passes (an LSD radix sort with the two indices as digits) in linear time.
+   The column and set offsets are computed in the pass that writes the output.
+
+   The column counting array spans all columns of the full grid, which for a
+   sparse cell is far more than the number of blocks. It is kept zeroed between
+   calls and only the columns that contain blocks are visited, so the cost is
+   O(nBlocks + nOccupiedColumns log nOccupiedColumns) and not O(nColumns). The
+   column ranges themselves cannot be kept between calls, since every call sorts
+   along a different dimension than the previous one and the mesh changes in
+   between (see AccelerationWorkspace in cpu_acc_map.cpp).
    
+   blocks has to have room for vmesh.size() elements. The offset and length
+   vectors are overwritten, and the work arrays in buffers are reused.
 */
-#warning "unfinished documentation"
 void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
                                const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
                                const uint dimension,
+                               ColumnSortBuffers& buffers,
                                uint* blocks,
                                std::vector<uint> & columnBlockOffsets,
                                std::vector<uint> & columnNumBlocks,
@@ -57,83 +67,108 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
    // Velocity mesh refinement level, has no effect here
    // but is needed in some vmesh::VelocityMesh function calls.
    const uint8_t REFLEVEL = 0;
+   const vmesh::LocalID* gridLength = vmesh.getGridLength(REFLEVEL);
    
-   // Copy block data to vector
-   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > block_pairs;
-   block_pairs.resize( nBlocks );
+   // Number of blocks along the dimension, and number of columns in the full grid
+   const vmesh::LocalID dimensionLength = gridLength[dimension];
+   const vmesh::LocalID nColumns = gridLength[0] * gridLength[1] * gridLength[2] / dimensionLength;
+
+   // Index of each block along the dimension, and of its column:
+   //   dimension 0: column = y + z*y_max
+   //   dimension 1: column = x + z*x_max
+   //   dimension 2: column = y + x*y_max
+   // The column ordering is the same as the order of the block ids mapped so that
+   // the dimension is the fastest running index, see below.
+   std::vector<vmesh::LocalID>& dimensionIds = buffers.dimensionIds;
+   std::vector<vmesh::LocalID>& columnIds = buffers.columnIds;
+   std::vector<uint>& dimensionCounts = buffers.dimensionCounts;
+   std::vector<uint>& columnCounts = buffers.columnCounts;
+   std::vector<vmesh::LocalID>& touchedColumns = buffers.touchedColumns;
+   dimensionIds.resize(nBlocks);
+   columnIds.resize(nBlocks);
+   dimensionCounts.assign(dimensionLength + 1, 0);
+   if (columnCounts.size() < nColumns) {
+      // Entries are zero between calls, only new ones need initializing
+      columnCounts.resize(nColumns, 0);
+   }
+   touchedColumns.clear();
    for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
       //const vmesh::GlobalID block = spatial_cell->get_velocity_block_global_id(i);
       const vmesh::GlobalID block = vmesh.getGlobalID(i);
+      const vmesh::LocalID x_index = block % gridLength[0];
+      const vmesh::LocalID y_index = (block / gridLength[0]) % gridLength[1];
+      const vmesh::LocalID z_index = block / (gridLength[0] * gridLength[1]);
       switch( dimension ) {
-       case 0: {
-          const vmesh::GlobalID blockId_mapped = block; // Mapping the block id to different coordinate system if dimension is not zero:
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
+       case 0:
+         // block = x + y*x_max + z*y_max*x_max
+         dimensionIds[i] = x_index;
+         columnIds[i] = y_index + z_index * gridLength[1];
          break;
-       case 1: {
-          // Do operation: 
-          //   block = x + y*x_max + z*y_max*x_max 
-          //=> block' = block - (x + y*x_max) + y + x*y_max = x + y*x_max + z*y_max*x_max - (x + y*x_max) + y + x*y_max
-          //          = y + x*y_max + z*y_max*x_max
-          //const uint x_indice = block%SpatialCell::get_velocity_grid_length()[0];
-          //const uint y_indice = (block/SpatialCell::get_velocity_grid_length()[0])%SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          const vmesh::LocalID x_index = block % vmesh.getGridLength(REFLEVEL)[0];
-          const vmesh::LocalID y_index = (block / vmesh.getGridLength(REFLEVEL)[0]) % vmesh.getGridLength(REFLEVEL)[1];
-
-          // Mapping the block id to different coordinate system if dimension is not zero:
-          //const uint blockId_mapped 
-          //        = block - (x_indice + y_indice*SpatialCell::get_velocity_grid_length()[0]) 
-          //        + y_indice 
-          //        + x_indice * SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          const vmesh::GlobalID blockId_mapped 
-                  = block - (x_index + y_index*vmesh.getGridLength(REFLEVEL)[0])
-                  + y_index 
-                  + x_index * vmesh.getGridLength(REFLEVEL)[1];
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
+       case 1:
+         // block' = y + x*y_max + z*y_max*x_max
+         dimensionIds[i] = y_index;
+         columnIds[i] = x_index + z_index * gridLength[0];
          break;
-       case 2: {
-          // Do operation: 
-          //   block = x + y*x_max + z*y_max*x_max 
-          //=> block' = z + y*z_max + x*z_max*y_max
-          //const uint x_indice = block%SpatialCell::get_velocity_grid_length()[0];
-          //const uint y_indice = (block/SpatialCell::get_velocity_grid_length()[0])%SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          //const uint z_indice =  (block/(SpatialCell::get_velocity_grid_length()[0]*SpatialCell::SpatialCell::get_velocity_grid_length()[1]));
-          const vmesh::LocalID x_index = block % vmesh.getGridLength(REFLEVEL)[0];
-          const vmesh::LocalID y_index = (block / vmesh.getGridLength(REFLEVEL)[0]) % vmesh.getGridLength(REFLEVEL)[1];
-          const vmesh::LocalID z_index = (block / (vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1]));
-
-          // Mapping the block id to different coordinate system if dimension is not zero:
-          //const uint blockId_mapped 
-          //  = z_indice 
-          //  + y_indice * SpatialCell::SpatialCell::get_velocity_grid_length()[2] 
-          //  + x_indice*SpatialCell::SpatialCell::get_velocity_grid_length()[1]*SpatialCell::SpatialCell::get_velocity_grid_length()[2];
-          const vmesh::GlobalID blockId_mapped 
-            = z_index 
-            + y_index*vmesh.getGridLength(REFLEVEL)[2]
-            + x_index*vmesh.getGridLength(REFLEVEL)[1]*vmesh.getGridLength(REFLEVEL)[2];
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
+       case 2:
+         // block' = z + y*z_max + x*z_max*y_max
+         dimensionIds[i] = z_index;
+         columnIds[i] = y_index + x_index * gridLength[1];
          break;
       }
+      ++dimensionCounts[dimensionIds[i] + 1];
+      if (columnCounts[columnIds[i]]++ == 0) {
+         touchedColumns.push_back(columnIds[i]);
+      }
+   }
+   for (vmesh::LocalID d = 0; d < dimensionLength; ++d) {
+      dimensionCounts[d + 1] += dimensionCounts[d];
+   }
+   // Exclusive prefix sum over the occupied columns only
+   std::sort(touchedColumns.begin(), touchedColumns.end());
+   uint columnOffset = 0;
+   for (const vmesh::LocalID c : touchedColumns) {
+      const uint count = columnCounts[c];
+      columnCounts[c] = columnOffset;
+      columnOffset += count;
+   }
+
+   // First pass, sort local ids by the index along the dimension
+   std::vector<vmesh::LocalID>& byDimension = buffers.byDimension;
+   byDimension.resize(nBlocks);
+   for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
+      byDimension[dimensionCounts[dimensionIds[i]]++] = i;
+   }
+   // Second pass, stable sort by column
+   std::vector<vmesh::LocalID>& sorted = buffers.sorted;
+   sorted.resize(nBlocks);
+   for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
+      const vmesh::LocalID lid = byDimension[i];
+      sorted[columnCounts[columnIds[lid]]++] = lid;
+   }
+   for (const vmesh::LocalID c : touchedColumns) {
+      columnCounts[c] = 0;
    }
-   // Sort the list:
-   std::sort( block_pairs.begin(), block_pairs.end(), paircomparator );
 
    // Put in the sorted blocks, and also compute column offsets and lengths:
+   columnBlockOffsets.clear();
+   columnNumBlocks.clear();
+   setColumnOffsets.clear();
+   setNumColumns.clear();
    columnBlockOffsets.push_back(0); //first offset
    setColumnOffsets.push_back(0); //first offset   
-   uint prev_column_id, prev_dimension_id;
+   vmesh::LocalID prev_column_id = 0;
+   vmesh::LocalID prev_dimension_id = 0;
 
    for (vmesh::LocalID i=0; i<nBlocks; ++i) {
+       const vmesh::LocalID lid = sorted[i];
        // identifies a particular column
-       vmesh::LocalID column_id = block_pairs[i].first / vmesh.getGridLength(REFLEVEL)[dimension];     
+       const vmesh::LocalID column_id = columnIds[lid];
        
        // identifies a particular block in a column (along the dimension)
-       vmesh::LocalID dimension_id = block_pairs[i].first % vmesh.getGridLength(REFLEVEL)[dimension];
+       const vmesh::LocalID dimension_id = dimensionIds[lid];
       
        //sorted list
-       blocks[i] = block_pairs[i].second;
+       blocks[i] = vmesh.getGlobalID(lid);
 
       if ( i > 0 &&  ( column_id != prev_column_id || dimension_id != (prev_dimension_id + 1) )){
          //encountered new column! For i=0, we already entered the correct offset (0).
@@ -29,9 +29,25 @@
 #include "../common.h"
 #include "../spatial_cell.hpp"
 
+/*! Work arrays of sortBlocklistByDimension. They are kept between calls (see
+  AccelerationWorkspace in cpu_acc_map.cpp) so that sorting does not allocate
+  memory once the arrays have grown to the size of the largest cell.*/
+struct ColumnSortBuffers {
+   std::vector<vmesh::LocalID> dimensionIds;  /*!< Index of each block along the dimension*/
+   std::vector<vmesh::LocalID> columnIds;     /*!< Index of the column of each block*/
+   std::vector<vmesh::LocalID> byDimension;   /*!< Local ids sorted by dimensionIds*/
+   std::vector<vmesh::LocalID> sorted;        /*!< Local ids sorted by columnIds, then dimensionIds*/
+   std::vector<uint> dimensionCounts;         /*!< Counting sort offsets for dimensionIds*/
+   std::vector<uint> columnCounts;            /*!< Counting sort offsets for columnIds, indexed by column.
+                                                   Only entries of touchedColumns are non-zero, and they
+                                                   are zeroed again before returning.*/
+   std::vector<vmesh::LocalID> touchedColumns; /*!< Columns that contain blocks, in ascending order*/
+};
+
 void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell, 
                                const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
                                const uint dimension,
+                               ColumnSortBuffers& buffers,
                                uint* blocks,
                                std::vector<uint> & columnBlockOffsets,
                                std::vector<uint> & columnNumBlocks,
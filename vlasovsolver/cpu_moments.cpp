@@ -28,6 +28,203 @@
 
 using namespace std;
 
+/** Where the moments computed by storeCellMoments go: indices of the bulk moments in 
+ * SpatialCell::parameters, and the moments of each population.*/
+struct MomentTargets {
+   int rhom,vx,vy,vz,rhoq,p11,p22,p33;
+   Real Population::* rho;
+   Real (Population::* v)[3];
+   Real (Population::* p)[3];
+};
+
+static const MomentTargets momentTargets = {
+   CellParams::RHOM,CellParams::VX,CellParams::VY,CellParams::VZ,CellParams::RHOQ,
+   CellParams::P_11,CellParams::P_22,CellParams::P_33,
+   &Population::RHO,&Population::V,&Population::P
+};
+static const MomentTargets momentTargets_R = {
+   CellParams::RHOM_R,CellParams::VX_R,CellParams::VY_R,CellParams::VZ_R,CellParams::RHOQ_R,
+   CellParams::P_11_R,CellParams::P_22_R,CellParams::P_33_R,
+   &Population::RHO_R,&Population::V_R,&Population::P_R
+};
+static const MomentTargets momentTargets_V = {
+   CellParams::RHOM_V,CellParams::VX_V,CellParams::VY_V,CellParams::VZ_V,CellParams::RHOQ_V,
+   CellParams::P_11_V,CellParams::P_22_V,CellParams::P_33_V,
+   &Population::RHO_V,&Population::V_V,&Population::P_V
+};
+
+/** Reference velocity of the moments of a population, the centre of its velocity mesh.
+ * @param popID ID of the particle species.
+ * @param vRef Array where the reference velocity is written.*/
+static void referenceVelocity(const uint popID,Real vRef[3]) {
+   const vmesh::MeshParameters& mesh
+      = getObjectWrapper().velocityMeshes[getObjectWrapper().particleSpecies[popID].velocityMesh];
+   for (int d=0; d<3; ++d) {
+      vRef[d] = 0.5*(mesh.meshMinLimits[d] + mesh.meshMaxLimits[d]);
+   }
+}
+
+/** Calculate the moments of the velocity blocks [start,end) of the given population.
+ * @param cell Spatial cell.
+ * @param popID ID of the particle species.
+ * @param start First block.
+ * @param end One past the last block.*/
+static VelocityMoments populationMoments(const SpatialCell* cell,const uint popID,
+                                         const vmesh::LocalID start,const vmesh::LocalID end) {
+   const Realf* data = cell->get_data(popID);
+   Real blockParams[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+   Real vRef[3];
+   referenceVelocity(popID,vRef);
+   
+   VelocityMoments moments;
+   for (vmesh::LocalID blockLID=start; blockLID<end; ++blockLID) {
+      cell->get_block_info(blockLID,popID,blockParams);
+      blockVelocityMoments(data+blockLID*WID3,blockParams,vRef,moments);
+   }
+   return moments;
+}
+
+/** Store the moments of all populations of the cell, and their contributions to the 
+ * bulk moments. The second moments are taken around the bulk velocity of all species, 
+ * they are obtained by shifting the populations' raw sums from their reference velocity 
+ * to the bulk velocity, without another pass over the blocks. Populations without blocks 
+ * are left as they are.
+ * @param cell Spatial cell.
+ * @param popMoments Moments of each population.
+ * @param computeSecond If true, second velocity moments are stored, otherwise the bulk ones are zeroed.
+ * @param targets Where the moments are stored.*/
+static void storeCellMoments(SpatialCell* cell,const VelocityMoments* popMoments,
+                             const bool& computeSecond,const MomentTargets& targets) {
+   const uint nPops = getObjectWrapper().particleSpecies.size();
+   Real rhom = 0.0;
+   Real rhoq = 0.0;
+   Real momentum[3] = {0.0,0.0,0.0};
+   for (uint popID=0; popID<nPops; ++popID) {
+      if (cell->get_number_of_velocity_blocks(popID) == 0) continue;
+      const VelocityMoments& moments = popMoments[popID];
+      const Real mass = getObjectWrapper().particleSpecies[popID].mass;
+      const Real charge = getObjectWrapper().particleSpecies[popID].charge;
+      Real vRef[3];
+      referenceVelocity(popID,vRef);
+      
+      Population & pop = cell->get_population(popID);
+      pop.*targets.rho = moments.n;
+      for (int d=0; d<3; ++d) {
+         (pop.*targets.v)[d] = moments.n > 0.0 ? vRef[d] + moments.nV[d]/moments.n : 0.0;
+         momentum[d] += (moments.n*vRef[d] + moments.nV[d])*mass;
+      }
+      rhom += moments.n*mass;
+      rhoq += moments.n*charge;
+   }
+   
+   cell->parameters[targets.rhom] = rhom;
+   cell->parameters[targets.vx] = divideIfNonZero(momentum[0], rhom);
+   cell->parameters[targets.vy] = divideIfNonZero(momentum[1], rhom);
+   cell->parameters[targets.vz] = divideIfNonZero(momentum[2], rhom);
+   cell->parameters[targets.rhoq] = rhoq;
+   cell->parameters[targets.p11] = 0.0;
+   cell->parameters[targets.p22] = 0.0;
+   cell->parameters[targets.p33] = 0.0;
+   
+   // Compute second moments only if requested
+   if (computeSecond == false) return;
+   
+   const Real bulkV[3] = {cell->parameters[targets.vx],cell->parameters[targets.vy],cell->parameters[targets.vz]};
+   const int pressure[3] = {targets.p11,targets.p22,targets.p33};
+   for (uint popID=0; popID<nPops; ++popID) {
+      if (cell->get_number_of_velocity_blocks(popID) == 0) continue;
+      const VelocityMoments& moments = popMoments[popID];
+      const Real mass = getObjectWrapper().particleSpecies[popID].mass;
+      Real vRef[3];
+      referenceVelocity(popID,vRef);
+      
+      Population & pop = cell->get_population(popID);
+      for (int d=0; d<3; ++d) {
+         // sum f*(v-bulkV)^2 = sum f*(v-vRef)^2 + 2*dV*sum f*(v-vRef) + dV^2*sum f
+         const Real dV = vRef[d] - bulkV[d];
+         (pop.*targets.p)[d] = mass*(moments.nV2[d] + 2.0*dV*moments.nV[d] + dV*dV*moments.n);
+         cell->parameters[pressure[d]] += (pop.*targets.p)[d];
+      }
+   }
+}
+
+/** Velocity blocks per work item in calculateMoments. Cells with more blocks are split 
+ * over several threads. Fixed, so that the results do not depend on the number of threads.*/
+static const vmesh::LocalID BLOCKS_PER_CHUNK = 1024;
+
+/** A range of velocity blocks of one population of one cell.*/
+struct MomentChunk {
+   uint cell;                   /**< Index of the cell in the list of cells.*/
+   uint popID;                  /**< ID of the particle species.*/
+   vmesh::LocalID start;        /**< First block.*/
+   vmesh::LocalID end;          /**< One past the last block.*/
+};
+
+/** Calculate zeroth, first, and (possibly) second bulk velocity moments for the 
+ * given spatial cells in one pass over the distribution functions. The blocks of 
+ * all cells and populations are split into chunks that are processed in parallel, 
+ * so that also the blocks of a large cell are shared among the threads. The moments 
+ * of the chunks of each cell are then summed in a fixed order. DO_NOT_COMPUTE cells 
+ * are skipped. Opens its own parallel region.
+ * @param mpiGrid Parallel grid library.
+ * @param cells Vector containing the spatial cells to be calculated.
+ * @param computeSecond If true, second velocity moments are calculated.
+ * @param targets Where the moments are stored.*/
+static void calculateMoments(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                             const std::vector<CellID>& cells,
+                             const bool& computeSecond,
+                             const MomentTargets& targets) {
+   const uint nPops = getObjectWrapper().particleSpecies.size();
+   
+   std::vector<MomentChunk> momentChunks;
+   std::vector<size_t> firstMomentChunk(cells.size()*nPops+1);
+   for (size_t c=0; c<cells.size(); ++c) {
+      SpatialCell* cell = mpiGrid[cells[c]];
+      for (uint popID=0; popID<nPops; ++popID) {
+         firstMomentChunk[c*nPops+popID] = momentChunks.size();
+         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
+         
+         const vmesh::LocalID nBlocks = cell->get_number_of_velocity_blocks(popID);
+         for (vmesh::LocalID start=0; start<nBlocks; start+=BLOCKS_PER_CHUNK) {
+            MomentChunk chunk;
+            chunk.cell = c;
+            chunk.popID = popID;
+            chunk.start = start;
+            chunk.end = min(start+BLOCKS_PER_CHUNK, nBlocks);
+            momentChunks.push_back(chunk);
+         }
+      }
+   }
+   firstMomentChunk[cells.size()*nPops] = momentChunks.size();
+   std::vector<VelocityMoments> chunkMoments(momentChunks.size());
+   
+   #pragma omp parallel
+   {
+      #pragma omp for schedule(dynamic,1)
+      for (size_t i=0; i<momentChunks.size(); ++i) {
+         const MomentChunk& chunk = momentChunks[i];
+         chunkMoments[i] = populationMoments(mpiGrid[cells[chunk.cell]], chunk.popID, chunk.start, chunk.end);
+      }
+      
+      std::vector<VelocityMoments> popMoments(nPops);
+      #pragma omp for
+      for (size_t c=0; c<cells.size(); ++c) {
+         SpatialCell* cell = mpiGrid[cells[c]];
+         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
+            continue;
+         }
+         
+         for (uint popID=0; popID<nPops; ++popID) {
+            popMoments[popID] = VelocityMoments();
+            for (size_t i=firstMomentChunk[c*nPops+popID]; i<firstMomentChunk[c*nPops+popID+1]; ++i) {
+               popMoments[popID].merge(chunkMoments[i]);
+            }
+         }
+         storeCellMoments(cell, popMoments.data(), computeSecond, targets);
+      }
+   }
+}
+
 /** Calculate zeroth, first, and (possibly) second bulk velocity moments for the 
  * given spatial cell. The calculated moments include contributions from 
  * all existing particle populations. This function is AMR safe.
@@ -40,100 +237,18 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
 
     // if doNotSkip == true then the first clause is false and we will never return,
     // i.e. always compute, otherwise we skip DO_NOT_COMPUTE cells
-    bool skipMoments = false;
     if (!doNotSkip && cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-        skipMoments = true;
-    }
-
-    // Clear old moments to zero value
-    if (skipMoments == false) {
-        cell->parameters[CellParams::RHOM  ] = 0.0;
-        cell->parameters[CellParams::VX] = 0.0;
-        cell->parameters[CellParams::VY] = 0.0;
-        cell->parameters[CellParams::VZ] = 0.0;
-        cell->parameters[CellParams::RHOQ  ] = 0.0;
-        cell->parameters[CellParams::P_11] = 0.0;
-        cell->parameters[CellParams::P_22] = 0.0;
-        cell->parameters[CellParams::P_33] = 0.0;
-    }
-
-    // Loop over all particle species
-    if (skipMoments == false) {
-       for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-          if (blockContainer.size() == 0) continue;
-          
-          const Realf* data       = blockContainer.getData();
-          const Real* blockParams = blockContainer.getParameters();
-          const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-          const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-          
-          // Temporary array for storing moments
-          Real array[4];
-          for (int i=0; i<4; ++i) array[i] = 0.0;
-
-          // Calculate species' contribution to first velocity moments
-          for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-             blockVelocityFirstMoments(data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                       array);
-          }
-          
-          Population & pop = cell->get_population(popID);
-          pop.RHO = array[0];
-          pop.V[0] = divideIfNonZero(array[1], array[0]);
-          pop.V[1] = divideIfNonZero(array[2], array[0]);
-          pop.V[2] = divideIfNonZero(array[3], array[0]);
-          
-          // Store species' contribution to bulk velocity moments
-          cell->parameters[CellParams::RHOM  ] += array[0]*mass;
-          cell->parameters[CellParams::VX] += array[1]*mass;
-          cell->parameters[CellParams::VY] += array[2]*mass;
-          cell->parameters[CellParams::VZ] += array[3]*mass;
-          cell->parameters[CellParams::RHOQ  ] += array[0]*charge;
-       } // for-loop over particle species
-       
-       cell->parameters[CellParams::VX] = divideIfNonZero(cell->parameters[CellParams::VX], cell->parameters[CellParams::RHOM]);
-       cell->parameters[CellParams::VY] = divideIfNonZero(cell->parameters[CellParams::VY], cell->parameters[CellParams::RHOM]);
-       cell->parameters[CellParams::VZ] = divideIfNonZero(cell->parameters[CellParams::VZ], cell->parameters[CellParams::RHOM]);
+        return;
     }
 
-    // Compute second moments only if requested
-    if (computeSecond == false) return;
-            
-    // Loop over all particle species
+    // Calculate species' moments in a single pass over their blocks. The buffer is
+    // reused by the calls of each thread, this is called for every cell in setCell.
+    static thread_local std::vector<VelocityMoments> popMoments;
+    popMoments.resize(getObjectWrapper().particleSpecies.size());
     for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-       vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-       if (blockContainer.size() == 0) continue;
-       
-       const Realf* data       = blockContainer.getData();
-       const Real* blockParams = blockContainer.getParameters();
-       const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-       
-       // Temporary array for storing moments
-       Real array[3];
-       for (int i=0; i<3; ++i) array[i] = 0.0;
-
-       // Calculate species' contribution to second velocity moments
-       Population & pop = cell->get_population(popID);
-       for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-          blockVelocitySecondMoments(data+blockLID*WID3,
-                                     blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                     cell->parameters[CellParams::VX],
-                                     cell->parameters[CellParams::VY],
-                                     cell->parameters[CellParams::VZ],
-                                     array);
-       }
-       
-       // Store species' contribution to bulk velocity moments
-       pop.P[0] = mass*array[0];
-       pop.P[1] = mass*array[1];
-       pop.P[2] = mass*array[2];
-       
-       cell->parameters[CellParams::P_11] += pop.P[0];
-       cell->parameters[CellParams::P_22] += pop.P[1];
-       cell->parameters[CellParams::P_33] += pop.P[2];
-    } // for-loop over particle species
+       popMoments[popID] = populationMoments(cell, popID, 0, cell->get_number_of_velocity_blocks(popID));
+    }
+    storeCellMoments(cell, popMoments.data(), computeSecond, momentTargets);
 }
 
 /** Calculate zeroth, first, and (possibly) second bulk velocity moments for the 
@@ -148,139 +263,8 @@ void calculateMoments_R(
         const std::vector<CellID>& cells,
         const bool& computeSecond) {
  
-    phiprof::start("compute-moments-n");
-    creal HALF = 0.5;
-
-    for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-       #pragma omp parallel for
-       for (size_t c=0; c<cells.size(); ++c) {
-          SpatialCell* cell = mpiGrid[cells[c]];
-          
-          if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-             continue;
-          }
-          
-          // Clear old moments to zero value
-          if (popID == 0) {
-             cell->parameters[CellParams::RHOM_R  ] = 0.0;
-             cell->parameters[CellParams::VX_R] = 0.0;
-             cell->parameters[CellParams::VY_R] = 0.0;
-             cell->parameters[CellParams::VZ_R] = 0.0;
-             cell->parameters[CellParams::RHOQ_R  ] = 0.0;
-             cell->parameters[CellParams::P_11_R] = 0.0;
-             cell->parameters[CellParams::P_22_R] = 0.0;
-             cell->parameters[CellParams::P_33_R] = 0.0;
-          }
-
-          const Real dx = cell->parameters[CellParams::DX];
-          const Real dy = cell->parameters[CellParams::DY];
-          const Real dz = cell->parameters[CellParams::DZ];
-
-          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-          if (blockContainer.size() == 0) continue;
-          const Realf* data       = blockContainer.getData();
-          const Real* blockParams = blockContainer.getParameters();
-          const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-          const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-
-          #ifdef DEBUG_MOMENTS
-          bool ok = true;
-          if (data == NULL && blockContainer.size() > 0) ok = false;
-          if (blockParams == NULL && blockContainer.size() > 0) ok = false;
-          if (ok == false) {
-             stringstream ss;
-             ss << "ERROR in moment calculation in " << __FILE__ << ":" << __LINE__ << endl;
-             ss << "\t &data = " << data << "\t &blockParams = " << blockParams << endl;
-             ss << "\t size = " << blockContainer.size() << endl;
-             cerr << ss.str();
-             exit(1);
-          }
-          #endif
-
-          // Temporary array where the moments for this species are accumulated
-          Real array[4];
-          for (int i=0; i<4; ++i) array[i] = 0.0;
-
-          // Calculate species' contribution to first velocity moments
-          for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-            blockVelocityFirstMoments(data+blockLID*WID3,
-                                      blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                      array);
-          } // for-loop over velocity blocks
-
-          // Store species' contribution to bulk velocity moments
-          Population & pop = cell->get_population(popID);
-          pop.RHO_R = array[0];
-          pop.V_R[0] = divideIfNonZero(array[1], array[0]);
-          pop.V_R[1] = divideIfNonZero(array[2], array[0]);
-          pop.V_R[2] = divideIfNonZero(array[3], array[0]);
-          
-          cell->parameters[CellParams::RHOM_R  ] += array[0]*mass;
-          cell->parameters[CellParams::VX_R] += array[1]*mass;
-          cell->parameters[CellParams::VY_R] += array[2]*mass;
-          cell->parameters[CellParams::VZ_R] += array[3]*mass;
-          cell->parameters[CellParams::RHOQ_R  ] += array[0]*charge;
-       } // for-loop over spatial cells
-    } // for-loop over particle species
-    
-    #pragma omp parallel for
-    for (size_t c=0; c<cells.size(); ++c) {
-       SpatialCell* cell = mpiGrid[cells[c]];
-       if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-          continue;
-       }
-       cell->parameters[CellParams::VX_R] = divideIfNonZero(cell->parameters[CellParams::VX_R], cell->parameters[CellParams::RHOM_R]);
-       cell->parameters[CellParams::VY_R] = divideIfNonZero(cell->parameters[CellParams::VY_R], cell->parameters[CellParams::RHOM_R]);
-       cell->parameters[CellParams::VZ_R] = divideIfNonZero(cell->parameters[CellParams::VZ_R], cell->parameters[CellParams::RHOM_R]);
-    }
-
-   // Compute second moments only if requested.
-   if (computeSecond == false) {
-      phiprof::stop("compute-moments-n");
-      return;
-   }
-
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-      #pragma omp parallel for
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-         
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         
-         vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-         if (blockContainer.size() == 0) continue;
-         const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-
-         // Temporary array where species' contribution to 2nd moments is accumulated
-         Real array[3];
-         for (int i=0; i<3; ++i) array[i] = 0.0;
-
-         // Calculate species' contribution to second velocity moments
-         Population & pop = cell->get_population(popID);
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-            blockVelocitySecondMoments(data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                       cell->parameters[CellParams::VX_R],
-                                       cell->parameters[CellParams::VY_R],
-                                       cell->parameters[CellParams::VZ_R],
-                                       array);
-         } // for-loop over velocity blocks
-
-         // Store species' contribution to 2nd bulk velocity moments
-         pop.P_R[0] = mass*array[0];
-         pop.P_R[1] = mass*array[1];
-         pop.P_R[2] = mass*array[2];
-         
-         cell->parameters[CellParams::P_11_R] += pop.P_R[0];
-         cell->parameters[CellParams::P_22_R] += pop.P_R[1];
-         cell->parameters[CellParams::P_33_R] += pop.P_R[2];
-      } // for-loop over spatial cells
-   } // for-loop over particle species
-
+   phiprof::start("compute-moments-n");
+   calculateMoments(mpiGrid, cells, computeSecond, momentTargets_R);
    phiprof::stop("compute-moments-n");
 }
 
@@ -298,121 +282,6 @@ void calculateMoments_V(
         const bool& computeSecond) {
  
    phiprof::start("Compute _V moments");
-   
-   // Loop over all particle species
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-      #pragma omp parallel for
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-         
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-         
-         // Clear old moments to zero value
-         if (popID == 0) {
-             cell->parameters[CellParams::RHOM_V  ] = 0.0;
-             cell->parameters[CellParams::VX_V] = 0.0;
-             cell->parameters[CellParams::VY_V] = 0.0;
-             cell->parameters[CellParams::VZ_V] = 0.0;
-             cell->parameters[CellParams::RHOQ_V  ] = 0.0;
-             cell->parameters[CellParams::P_11_V] = 0.0;
-             cell->parameters[CellParams::P_22_V] = 0.0;
-             cell->parameters[CellParams::P_33_V] = 0.0;
-         }
-
-         vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-         if (blockContainer.size() == 0) continue;
-         const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-         const Real charge = getObjectWrapper().particleSpecies[popID].charge;
-
-         // Temporary array for storing moments
-         Real array[4];
-         for (int i=0; i<4; ++i) array[i] = 0.0;
-
-         // Calculate species' contribution to first velocity moments
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-            blockVelocityFirstMoments(data+blockLID*WID3,
-                                      blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                      array);
-         }
-         
-         // Store species' contribution to bulk velocity moments
-         Population & pop = cell->get_population(popID);
-         pop.RHO_V = array[0];
-         pop.V_V[0] = divideIfNonZero(array[1], array[0]);
-         pop.V_V[1] = divideIfNonZero(array[2], array[0]);
-         pop.V_V[2] = divideIfNonZero(array[3], array[0]);
-         
-         cell->parameters[CellParams::RHOM_V  ] += array[0]*mass;
-         cell->parameters[CellParams::VX_V] += array[1]*mass;
-         cell->parameters[CellParams::VY_V] += array[2]*mass;
-         cell->parameters[CellParams::VZ_V] += array[3]*mass;
-         cell->parameters[CellParams::RHOQ_V  ] += array[0]*charge;
-      } // for-loop over spatial cells
-   } // for-loop over particle species
-   
-   #pragma omp parallel for
-   for (size_t c=0; c<cells.size(); ++c) {
-      SpatialCell* cell = mpiGrid[cells[c]];
-      if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-         continue;
-      }
-      cell->parameters[CellParams::VX_V] = divideIfNonZero(cell->parameters[CellParams::VX_V], cell->parameters[CellParams::RHOM_V]);
-      cell->parameters[CellParams::VY_V] = divideIfNonZero(cell->parameters[CellParams::VY_V], cell->parameters[CellParams::RHOM_V]);
-      cell->parameters[CellParams::VZ_V] = divideIfNonZero(cell->parameters[CellParams::VZ_V], cell->parameters[CellParams::RHOM_V]);
-   }
-
-   // Compute second moments only if requested
-   if (computeSecond == false) {
-      phiprof::stop("Compute _V moments");
-      return;
-   }
-
-   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-      #pragma omp parallel for
-      for (size_t c=0; c<cells.size(); ++c) {
-         SpatialCell* cell = mpiGrid[cells[c]];
-         
-         if (cell->sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) {
-            continue;
-         }
-
-         vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-         if (blockContainer.size() == 0) continue;
-         const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
-         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-
-         // Temporary array where moments are stored
-         Real array[3];
-         for (int i=0; i<3; ++i) array[i] = 0.0;
-
-         // Calculate species' contribution to second velocity moments
-         Population & pop = cell->get_population(popID);
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
-            blockVelocitySecondMoments(
-                                       data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
-                                       cell->parameters[CellParams::VX_V],
-                                       cell->parameters[CellParams::VY_V],
-                                       cell->parameters[CellParams::VZ_V],
-                                       array);
-         } // for-loop over velocity blocks
-         
-         // Store species' contribution to 2nd bulk velocity moments
-         pop.P_V[0] = mass*array[0];
-         pop.P_V[1] = mass*array[1];
-         pop.P_V[2] = mass*array[2];
-         
-         cell->parameters[CellParams::P_11_V] += pop.P_V[0];
-         cell->parameters[CellParams::P_22_V] += pop.P_V[1];
-         cell->parameters[CellParams::P_33_V] += pop.P_V[2];
-         
-      } // for-loop over spatial cells
-   } // for-loop over particle species
-
+   calculateMoments(mpiGrid, cells, computeSecond, momentTargets_V);
    phiprof::stop("Compute _V moments");
 }
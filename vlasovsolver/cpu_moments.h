@@ -34,6 +34,22 @@
 
 using namespace spatial_cell;
 
+/** Zeroth, first and second velocity moments of a particle population, or of a part of its
+ * velocity blocks, as raw sums around a reference velocity vRef: the scaled number density 
+ * n = sum f*dv^3, nV = sum f*(v-vRef)*dv^3 and nV2 = sum f*(v-vRef)^2*dv^3 in each direction.
+ * All blocks of a population use the same vRef, the centre of its velocity mesh (see 
+ * referenceVelocity() in cpu_moments.cpp), so the moments of disjoint sets of blocks are combined by adding 
+ * them with merge(). Taking the velocities relative to vRef instead of zero limits the 
+ * cancellation when the second moments around the bulk velocity are formed from the sums.*/
+struct VelocityMoments {
+   Real n;
+   Real nV[3];
+   Real nV2[3];
+   
+   VelocityMoments(): n(0.0),nV{0.0,0.0,0.0},nV2{0.0,0.0,0.0} { }
+   void merge(const VelocityMoments& other);
+};
+
 // ***** FUNCTION DECLARATIONS ***** //
 
 template<typename REAL> 
@@ -45,6 +61,9 @@ void blockVelocitySecondMoments(const Realf* avgs,const Real* blockParams,
                                 const REAL v[3],
                                 REAL* array);
 
+void blockVelocityMoments(const Realf* avgs,const Real* blockParams,
+                          const Real vRef[3],VelocityMoments& moments);
+
 void calculateMoments_R(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                               const std::vector<CellID>& cells,
                               const bool& computeSecond);
@@ -137,4 +156,72 @@ void blockVelocitySecondMoments(
    array[2] += nvz2_sum * DV3;
 }
 
+/** Add the moments of another, disjoint set of velocity blocks to these moments.
+ * The other moments must be taken around the same reference velocity.
+ * @param other Moments of the other blocks.*/
+inline void VelocityMoments::merge(const VelocityMoments& other) {
+   n += other.n;
+   for (int d=0; d<3; ++d) {
+      nV[d]  += other.nV[d];
+      nV2[d] += other.nV2[d];
+   }
+}
+
+/** Calculate the zeroth, first and second velocity moments of the given velocity 
+ * block in a single pass, and add them to 'moments'. The sums are first taken 
+ * relative to the centre of the block, where they are well conditioned, and then 
+ * shifted to the reference velocity. The cells of the block are processed in SIMD 
+ * lanes. This function is AMR safe.
+ * @param avgs Distribution function.
+ * @param blockParams Parameters for the given velocity block.
+ * @param vRef Reference velocity of the moments.
+ * @param moments Moments where the block's moments are added.*/
+inline void blockVelocityMoments(
+        const Realf* avgs,
+        const Real* blockParams,
+        const Real vRef[3],
+        VelocityMoments& moments) {
+
+   const Real HALF = 0.5;
+   const Real DVX = blockParams[BlockParams::DVX];
+   const Real DVY = blockParams[BlockParams::DVY];
+   const Real DVZ = blockParams[BlockParams::DVZ];
+
+   Real n_sum = 0.0;
+   Real vx_sum = 0.0;
+   Real vy_sum = 0.0;
+   Real vz_sum = 0.0;
+   Real vx2_sum = 0.0;
+   Real vy2_sum = 0.0;
+   Real vz2_sum = 0.0;
+   #pragma omp simd reduction(+:n_sum,vx_sum,vy_sum,vz_sum,vx2_sum,vy2_sum,vz2_sum)
+   for (uint cell=0; cell<WID3; ++cell) {
+      const Real VX = (cell % WID        + HALF - HALF*WID) * DVX;
+      const Real VY = (cell / WID % WID  + HALF - HALF*WID) * DVY;
+      const Real VZ = (cell / WID2       + HALF - HALF*WID) * DVZ;
+      const Real f = avgs[cell];
+      
+      n_sum   += f;
+      vx_sum  += f*VX;
+      vy_sum  += f*VY;
+      vz_sum  += f*VZ;
+      vx2_sum += f*VX*VX;
+      vy2_sum += f*VY*VY;
+      vz2_sum += f*VZ*VZ;
+   }
+   
+   // Offset of the block centre from the reference velocity
+   const Real DX = blockParams[BlockParams::VXCRD] + HALF*WID*DVX - vRef[0];
+   const Real DY = blockParams[BlockParams::VYCRD] + HALF*WID*DVY - vRef[1];
+   const Real DZ = blockParams[BlockParams::VZCRD] + HALF*WID*DVZ - vRef[2];
+   const Real DV3 = DVX*DVY*DVZ;
+   moments.n      += n_sum * DV3;
+   moments.nV[0]  += (vx_sum + DX*n_sum) * DV3;
+   moments.nV[1]  += (vy_sum + DY*n_sum) * DV3;
+   moments.nV[2]  += (vz_sum + DZ*n_sum) * DV3;
+   moments.nV2[0] += (vx2_sum + 2.0*DX*vx_sum + DX*DX*n_sum) * DV3;
+   moments.nV2[1] += (vy2_sum + 2.0*DY*vy_sum + DY*DY*n_sum) * DV3;
+   moments.nV2[2] += (vz2_sum + 2.0*DZ*vz_sum + DZ*DZ*n_sum) * DV3;
+}
+
 #endif
@@ -22,7 +22,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <set>
 #include <utility>
+#include <unordered_set>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -250,23 +252,24 @@ void copy_trans_block_data(
     const uint popID) { 
 
    /*load pointers to blocks and prefetch them to L1*/
-   Realf* blockDatas[VLASOV_STENCIL_WIDTH * 2 + 1];
+   // Read only through const pointers, so that blocks shared with a template cell are not copied
+   const Realf* blockDatas[VLASOV_STENCIL_WIDTH * 2 + 1];
    for (int b = -VLASOV_STENCIL_WIDTH; b <= VLASOV_STENCIL_WIDTH; ++b) {
-      SpatialCell* srcCell = source_neighbors[b + VLASOV_STENCIL_WIDTH];
+      const SpatialCell* srcCell = source_neighbors[b + VLASOV_STENCIL_WIDTH];
       const vmesh::LocalID blockLID = srcCell->get_velocity_block_local_id(blockGID,popID);
       if (blockLID != srcCell->invalid_local_id()) {
          blockDatas[b + VLASOV_STENCIL_WIDTH] = srcCell->get_data(blockLID,popID);
          //prefetch storage pointers to L1
-         _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]), _MM_HINT_T0);
-         _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 64, _MM_HINT_T0);
-         _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 128, _MM_HINT_T0);
-         _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 192, _MM_HINT_T0);
+         _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]), _MM_HINT_T0);
+         _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 64, _MM_HINT_T0);
+         _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 128, _MM_HINT_T0);
+         _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 192, _MM_HINT_T0);
          if(VPREC  == 8) {
             //prefetch storage pointers to L1
-            _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 256, _MM_HINT_T0);
-            _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 320, _MM_HINT_T0);
-            _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 384, _MM_HINT_T0);
-            _mm_prefetch((char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 448, _MM_HINT_T0);
+            _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 256, _MM_HINT_T0);
+            _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 320, _MM_HINT_T0);
+            _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 384, _MM_HINT_T0);
+            _mm_prefetch((const char *)(blockDatas[b + VLASOV_STENCIL_WIDTH]) + 448, _MM_HINT_T0);
          }
       }
       else{
@@ -309,21 +312,169 @@ void copy_trans_block_data(
    }
 }
 
+/* Split the propagated cells into cells that can be translated without data from other
+   processes, and cells that need it. Translation along a dimension only couples the cells
+   on the same line along that dimension, so whole lines are put in the boundary set if any
+   of their cells is on the process boundary of the translation stencil.
+
+   \param mpiGrid Grid
+   \param localPropagatedCells Local cells that get propagated
+   \param dimension 0,1,2 for x,y,z
+   \param innerCells Cells on lines that have no process boundary cells
+   \param boundaryCells The rest of localPropagatedCells
+*/
+void splitTranslationCells(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                           const vector<CellID>& localPropagatedCells,
+                           const uint dimension,
+                           vector<CellID>& innerCells,
+                           vector<CellID>& boundaryCells) {
+   int neighborhood = 0;
+   switch (dimension) {
+   case 0:
+      neighborhood = VLASOV_SOLVER_X_NEIGHBORHOOD_ID;
+      break;
+   case 1:
+      neighborhood = VLASOV_SOLVER_Y_NEIGHBORHOOD_ID;
+      break;
+   case 2:
+      neighborhood = VLASOV_SOLVER_Z_NEIGHBORHOOD_ID;
+      break;
+   default:
+      cerr << __FILE__ << ":"<< __LINE__ << " Wrong dimension, abort"<<endl;
+      abort();
+      break;
+   }
+
+   // Lines along dimension are identified by the indices in the two other dimensions
+   auto lineOf = [&mpiGrid,dimension](const CellID cell) {
+      const auto indices = mpiGrid.mapping.get_indices(cell);
+      return std::make_pair(indices[(dimension + 1) % 3], indices[(dimension + 2) % 3]);
+   };
+
+   std::set<std::pair<uint64_t,uint64_t>> boundaryLines;
+   for (const auto cell : mpiGrid.get_local_cells_on_process_boundary(neighborhood)) {
+      boundaryLines.insert(lineOf(cell));
+   }
+
+   innerCells.clear();
+   boundaryCells.clear();
+   for (const auto cell : localPropagatedCells) {
+      if (boundaryLines.count(lineOf(cell)) > 0) {
+         boundaryCells.push_back(cell);
+      } else {
+         innerCells.push_back(cell);
+      }
+   }
+}
+
+/* Cell sets of the dimension being translated and the velocity blocks of each set, see
+   trans_map_1d. */
+struct TranslationSetCache {
+   bool valid;
+   uint popID;
+   vector<CellID> innerCells;
+   vector<CellID> boundaryCells;
+   vector<vmesh::GlobalID> allBlocks;
+   vector<vmesh::GlobalID> innerBlocks;
+   vector<vmesh::GlobalID> boundaryBlocks;
+
+   TranslationSetCache(): valid(false), popID(0) { }
+};
+
+static TranslationSetCache translationSetCache[3];
+
+/* Get a unique list of the blockids that are in any of the given cells. First use set
+   for this, then add to vector (may not be the most nice way to do this and in any case
+   we could do it along dimension for data locality reasons => copy acc map column code,
+   TODO: FIXME */
+static void getUnionOfBlocks(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                             const vector<CellID>& cells,
+                             const vector<CellID>& moreCells,
+                             const uint popID,
+                             vector<vmesh::GlobalID>& unionOfBlocks) {
+   std::unordered_set<vmesh::GlobalID> unionOfBlocksSet;
+   for (const vector<CellID>* list : {&cells, &moreCells}) {
+      for (const CellID cell : *list) {
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = mpiGrid[cell]->get_velocity_mesh(popID);
+         for (vmesh::LocalID block_i=0; block_i< vmesh.size(); ++block_i) {
+            unionOfBlocksSet.insert(vmesh.getGlobalID(block_i));
+         }
+      }
+   }
+   
+   unionOfBlocks.clear();
+   unionOfBlocks.reserve(unionOfBlocksSet.size());
+   for(const auto blockGID:  unionOfBlocksSet) {
+      unionOfBlocks.push_back(blockGID);
+   }
+}
+
+static bool trans_map_1d_cells(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                               const vector<CellID>& localPropagatedCells,
+                               const vector<CellID>& remoteTargetCells,
+                               const vector<vmesh::GlobalID>& unionOfBlocks,
+                               const uint dimension,
+                               const Realv dt,
+                               const uint popID);
+
 /* 
    Here we map from the current time step grid, to a target grid which
    is the lagrangian departure grid (so th grid at timestep +dt,
    tracked backwards by -dt). This is done in ordinary space in the translation step
 
-   This function can, and should be, safely called in a parallel
-   OpenMP region (as long as it does only one dimension per parallel
-   refion). It is safe as each thread only computes certain blocks (blockID%tnum_threads = thread_num */
+   cellSet selects which of the propagated cells are mapped, see translationset. Inner cells
+   have no remote target cells. The first set mapped in a dimension (ALL or INNER) splits the
+   cells and collects the velocity blocks of each set, BOUNDARY reuses them. The blocks of
+   the cells do not change while a dimension is translated. */
 
 bool trans_map_1d(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                   const vector<CellID>& localPropagatedCells,
                   const vector<CellID>& remoteTargetCells,
                   const uint dimension,
                   const Realv dt,
-                  const uint popID) {
+                  const uint popID,
+                  const uint cellSet) {
+   TranslationSetCache& cache = translationSetCache[dimension];
+   const bool firstCellSet = (cellSet == translationset::ALL || cellSet == translationset::INNER);
+   if (firstCellSet || !cache.valid || cache.popID != popID) {
+      phiprof::start("buildBlockList");
+      if (cellSet == translationset::ALL) {
+         getUnionOfBlocks(mpiGrid, localPropagatedCells, remoteTargetCells, popID, cache.allBlocks);
+      } else {
+         cache.innerCells.clear();
+         cache.boundaryCells.clear();
+         splitTranslationCells(mpiGrid, localPropagatedCells, dimension, cache.innerCells, cache.boundaryCells);
+         getUnionOfBlocks(mpiGrid, cache.innerCells, vector<CellID>(), popID, cache.innerBlocks);
+         getUnionOfBlocks(mpiGrid, cache.boundaryCells, remoteTargetCells, popID, cache.boundaryBlocks);
+      }
+      cache.valid = true;
+      cache.popID = popID;
+      phiprof::stop("buildBlockList");
+   }
+   
+   switch (cellSet) {
+   case translationset::ALL:
+      return trans_map_1d_cells(mpiGrid, localPropagatedCells, remoteTargetCells, cache.allBlocks, dimension, dt, popID);
+   case translationset::INNER:
+      return trans_map_1d_cells(mpiGrid, cache.innerCells, vector<CellID>(), cache.innerBlocks, dimension, dt, popID);
+   default:
+      return trans_map_1d_cells(mpiGrid, cache.boundaryCells, remoteTargetCells, cache.boundaryBlocks, dimension, dt, popID);
+   }
+}
+
+/* Map the given cells and their remote targets along dimension, see trans_map_1d.
+   unionOfBlocks holds the blocks in any of these cells.
+
+   This function can, and should be, safely called in a parallel
+   OpenMP region (as long as it does only one dimension per parallel
+   refion). It is safe as each thread only computes certain blocks (blockID%tnum_threads = thread_num */
+static bool trans_map_1d_cells(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                               const vector<CellID>& localPropagatedCells,
+                               const vector<CellID>& remoteTargetCells,
+                               const vector<vmesh::GlobalID>& unionOfBlocks,
+                               const uint dimension,
+                               const Realv dt,
+                               const uint popID) {
    // values used with an stencil in 1 dimension, initialized to 0. 
    // Contains a block, and its spatial neighbours in one dimension.
    Realv dz,z_min, dvz,vz_min;
@@ -358,31 +509,6 @@ bool trans_map_1d(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
       compute_spatial_target_neighbors(mpiGrid, localPropagatedCells[celli], dimension, targetNeighbors.data() + celli * 3);
    }
    
-    
-   //Get a unique sorted list of blockids that are in any of the
-   // propagated cells. First use set for this, then add to vector (may not
-   // be the most nice way to do this and in any case we could do it along
-   // dimension for data locality reasons => copy acc map column code, TODO: FIXME
-   std::unordered_set<vmesh::GlobalID> unionOfBlocksSet;
-   
-
-
-   for(uint celli = 0; celli < allCellsPointer.size(); celli++) {
-      vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = allCellsPointer[celli]->get_velocity_mesh(popID);
-      for (vmesh::LocalID block_i=0; block_i< vmesh.size(); ++block_i) {
-         unionOfBlocksSet.insert(vmesh.getGlobalID(block_i));
-      }
-   }
-   
-   std::vector<vmesh::GlobalID> unionOfBlocks;
-   unionOfBlocks.reserve(unionOfBlocksSet.size());
-   for(const auto blockGID:  unionOfBlocksSet) {
-      unionOfBlocks.push_back(blockGID);
-   }
-   
-    
-
-   
    const uint8_t REFLEVEL=0;
    const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = allCellsPointer[0]->get_velocity_mesh(popID);
    // set cell size in dimension direction
@@ -663,7 +789,9 @@ void update_remote_mapping_contribution(
       //default values, to avoid any extra sends and receives
       for (uint i = 0; i < MAX_NEIGHBORS_PER_DIM; ++i) {
          if(i == 0) {
-            ccell->neighbor_block_data.at(i) = ccell->get_data(popID);
+            // Placeholder for the empty default transfer, taken through const access so that
+            // blocks shared with a template cell are not copied
+            ccell->neighbor_block_data.at(i) = const_cast<Realf*>(static_cast<const SpatialCell*>(ccell)->get_data(popID));
          } else {
             ccell->neighbor_block_data.at(i) = NULL;
          }
@@ -678,7 +806,9 @@ void update_remote_mapping_contribution(
       //default values, to avoid any extra sends and receives
       for (uint i = 0; i < MAX_NEIGHBORS_PER_DIM; ++i) {
          if(i == 0) {
-            ccell->neighbor_block_data.at(i) = ccell->get_data(popID);
+            // Placeholder for the empty default transfer, taken through const access so that
+            // blocks shared with a template cell are not copied
+            ccell->neighbor_block_data.at(i) = const_cast<Realf*>(static_cast<const SpatialCell*>(ccell)->get_data(popID));
          } else {
             ccell->neighbor_block_data.at(i) = NULL;
          }
@@ -44,13 +44,34 @@ void store_trans_block_data(SpatialCell** target_neighbors,const vmesh::GlobalID
                             Vec* __restrict__ target_values,
                             const unsigned char* const cellid_transpose,const uint popID);
 
+/*! Sets of local cells updated by one call of trans_map_1d or trans_map_1d_amr. The inner
+ * cells read and write no data that is communicated with other processes, so they can be
+ * translated while the stencil data of the boundary cells is in transfer.
+ */
+namespace translationset {
+   enum {
+      ALL,       /*!< All propagated cells.*/
+      INNER,     /*!< Cells that are not connected to process boundaries along the translated dimension.*/
+      BOUNDARY,  /*!< Cells that are connected to process boundaries along the translated dimension.*/
+      INNER_1,   /*!< First third of the inner cells, trans_map_1d_amr only.*/
+      INNER_2,   /*!< Second third of the inner cells, trans_map_1d_amr only.*/
+      INNER_3    /*!< Last third of the inner cells, trans_map_1d_amr only.*/
+   };
+}
+
 bool do_translate_cell(spatial_cell::SpatialCell* SC);
+void splitTranslationCells(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                           const std::vector<CellID>& localPropagatedCells,
+                           const uint dimension,
+                           std::vector<CellID>& innerCells,
+                           std::vector<CellID>& boundaryCells);
 bool trans_map_1d(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                   const std::vector<CellID>& localPropagatedCells,
                   const std::vector<CellID>& remoteTargetCells,
                   const uint dimension,
                   const Realv dt,
-                  const uint popID);
+                  const uint popID,
+                  const uint cellSet);
 void update_remote_mapping_contribution(dccrg::Dccrg<spatial_cell::SpatialCell,
                                         dccrg::Cartesian_Geometry>& mpiGrid,
                                         const uint dimension,
@@ -7,6 +7,9 @@
 #include "cpu_trans_map_amr.hpp"
 #include "cpu_trans_map.hpp"
 
+#include <algorithm>
+#include <omp.h>
+
 using namespace std;
 using namespace spatial_cell;
 
@@ -714,14 +717,15 @@ bool copy_trans_block_data_amr(
     const unsigned char* const cellid_transpose,
     const uint popID) { 
 
-   // Allocate data pointer for all blocks in pencil. Pad on both ends by VLASOV_STENCIL_WIDTH
-   Realf* blockDataPointer[lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH];   
+   // Allocate data pointer for all blocks in pencil. Pad on both ends by VLASOV_STENCIL_WIDTH.
+   // Read only through const pointers, so that blocks shared with a template cell are not copied
+   const Realf* blockDataPointer[lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH];   
 
    int nonEmptyBlocks = 0;
 
    for (int b = -VLASOV_STENCIL_WIDTH; b < lengthOfPencil + VLASOV_STENCIL_WIDTH; b++) {
       // Get cell pointer and local block id
-      SpatialCell* srcCell = source_neighbors[b + VLASOV_STENCIL_WIDTH];
+      const SpatialCell* srcCell = source_neighbors[b + VLASOV_STENCIL_WIDTH];
          
       const vmesh::LocalID blockLID = srcCell->get_velocity_block_local_id(blockGID,popID);
       if (blockLID != srcCell->invalid_local_id()) {
@@ -967,9 +971,423 @@ void printPencilsFunc(const setOfPencils& pencils, const uint dimension, const i
    MPI_Barrier(MPI_COMM_WORLD);
 }
 
+/* Pencils, and the spatial cells they read from and write to, only depend on
+ * the spatial mesh and its partitioning. They are therefore built once per
+ * dimension and reused until the mesh is repartitioned.
+ */
+struct PencilCache {
+   bool valid;
+   setOfPencils pencils;
+   std::vector<SpatialCell*> targetCells; // Target cells of all pencils, padded by 1 cell on both ends of each pencil
+   std::vector<std::vector<SpatialCell*>> pencilSourceCells; // Source cells of each pencil, padded by VLASOV_STENCIL_WIDTH
+   std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencildz; // Cell widths along the pencil, same padding as source cells
+   std::vector<uint> nPencilsThroughCell; // Number of pencils through each of localPropagatedCells
+   std::vector<bool> isBoundaryPencil; // True if the pencil, or a pencil sharing cells with it, needs data from other processes
+   std::vector<uint8_t> innerPart; // Which third of the inner pencils the pencil belongs to, see translationset::INNER_1
+
+   PencilCache() : valid(false) { }
+};
+
+static std::array<PencilCache,3> pencilCache;
+
+/* Pencils are grouped into the boundary pencils and the three parts of the inner pencils,
+ * every set of cells of translationset maps a consecutive range of these groups.
+ */
+const uint nPencilGroups = 4;
+
+/* Velocity blocks of the cells mapped in one dimension, and the pencils that propagate
+ * each of them. Blocks are not added or removed while a dimension is translated, so the
+ * lists are built by the first set of pencils mapped in the dimension and reused by the
+ * other sets.
+ */
+struct PencilBlockCache {
+   bool valid;
+   uint popID;
+   std::vector<vmesh::GlobalID> unionOfBlocks; // Sorted blocks that are in any of the propagated or target cells
+   std::vector<uint> blockPencilsStart; // Offset of each pencil group of each block of unionOfBlocks in blockPencils
+   std::vector<uint> blockPencils; // Pencils that have the block in any of their source cells, by group and in pencil order
+
+   PencilBlockCache() : valid(false), popID(0) { }
+};
+
+static std::array<PencilBlockCache,3> pencilBlockCache;
+
+/* Pencil group of the pencil, see nPencilGroups.
+ */
+static uint getPencilGroup(const PencilCache& cache, const uint pencili) {
+   return cache.isBoundaryPencil[pencili] ? 0 : 1 + cache.innerPart[pencili];
+}
+
+/* Pencil groups [firstGroup, endGroup) that are mapped when mapping the given set of cells,
+ * see translationset.
+ */
+static void getCellSetGroups(const uint cellSet, uint& firstGroup, uint& endGroup) {
+   switch (cellSet) {
+   case translationset::INNER:
+      firstGroup = 1;
+      endGroup = nPencilGroups;
+      break;
+   case translationset::BOUNDARY:
+      firstGroup = 0;
+      endGroup = 1;
+      break;
+   case translationset::INNER_1:
+   case translationset::INNER_2:
+   case translationset::INNER_3:
+      firstGroup = 1 + cellSet - translationset::INNER_1;
+      endGroup = firstGroup + 1;
+      break;
+   default:
+      firstGroup = 0;
+      endGroup = nPencilGroups;
+      break;
+   }
+}
+
+/* Per-thread scratch buffers for mapping blocks through pencils. A thread maps one
+ * pencil at a time, so the source and target vector buffers only need to fit the
+ * longest pencil, and targetBlockData only the pencils of the block being mapped.
+ * The buffers persist across calls and only ever grow.
+ */
+struct PencilScratch {
+   std::vector<Vec, aligned_allocator<Vec,WID3>> sourceVecData;
+   std::vector<Vec, aligned_allocator<Vec,WID3>> targetValues;
+   std::vector<Realf, aligned_allocator<Realf,WID3>> targetBlockData;
+   std::vector<uint> targetBlockStart; // Offset of each pencil of the current block in targetBlockData
+};
+
+static std::vector<PencilScratch> pencilScratch;
+
+/* Build the pencils for one dimension and store them, together with their source
+ * and target cells, in the pencil cache.
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ * @param [in] localPropagatedCells List of local cells that get propagated
+ * ie. not boundary or DO_NOT_COMPUTE
+ * @param [in] dimension Spatial dimension
+ * @param [out] cache Pencil cache of this dimension
+ */
+void buildPencilCache(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                      const vector<CellID>& localPropagatedCells,
+                      const uint dimension,
+                      PencilCache& cache) {
+
+   const bool printPencils = false;
+   int myRank;
+   if(printPencils) MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+
+   phiprof::start("getSeedIds");
+   vector<CellID> seedIds;
+   getSeedIds(mpiGrid, localPropagatedCells, dimension, seedIds);
+   phiprof::stop("getSeedIds");
+   
+   phiprof::start("buildPencils");
+
+   // Output vectors for ready pencils
+   setOfPencils pencils;
+   
+#pragma omp parallel
+   {
+      // Empty vectors for internal use of buildPencilsWithNeighbors. Could be default values but
+      // default vectors are complicated. Should overload buildPencilsWithNeighbors like suggested here
+      // https://stackoverflow.com/questions/3147274/c-default-argument-for-vectorint
+      vector<CellID> ids;
+      vector<uint> path;
+      // thread-internal pencil set to be accumulated at the end
+      setOfPencils thread_pencils;
+      // iterators used in the accumulation
+      std::vector<CellID>::iterator ibeg, iend;
+      
+#pragma omp for schedule(guided)
+      for (uint i=0; i<seedIds.size(); i++) {
+         cuint seedId = seedIds[i];
+         // Construct pencils from the seedIds into a set of pencils.
+         thread_pencils = buildPencilsWithNeighbors(mpiGrid, thread_pencils, seedId, ids, dimension, path, seedIds);
+      }
+      
+      // accumulate thread results in global set of pencils
+#pragma omp critical
+      {
+         for (uint i=0; i<thread_pencils.N; i++) {
+            // Use vector range constructor
+            ibeg = thread_pencils.ids.begin() + thread_pencils.idsStart[i];
+            iend = ibeg + thread_pencils.lengthOfPencils[i];
+            std::vector<CellID> pencilIds(ibeg, iend);
+            pencils.addPencil(pencilIds,thread_pencils.x[i],thread_pencils.y[i],thread_pencils.periodic[i],thread_pencils.path[i]);
+         }
+      }
+   }
+   
+   // Check refinement of two ghost cells on each end of each pencil
+   check_ghost_cells(mpiGrid,pencils,dimension);
+   // ****************************************************************************   
+
+   if(printPencils) printPencilsFunc(pencils,dimension,myRank);
+
+   if(!checkPencils(mpiGrid, localPropagatedCells, pencils)) {
+      abort();
+   }
+
+   // Count the pencils going through each propagated cell, needed for the load balance weights
+   std::unordered_map<CellID,uint> pencilCounts;
+   for (auto id : pencils.ids) {
+      pencilCounts[id]++;
+   }
+   cache.nPencilsThroughCell.assign(localPropagatedCells.size(), 0);
+   for (uint i=0; i<localPropagatedCells.size(); i++) {
+      auto it = pencilCounts.find(localPropagatedCells[i]);
+      if (it != pencilCounts.end()) {
+         cache.nPencilsThroughCell[i] = it->second;
+      }
+   }
+   phiprof::stop("buildPencils");
+   
+   // Assuming 1 neighbor in the target array because of the CFL condition
+   // In fact propagating to > 1 neighbor will give an error
+   const uint nTargetNeighborsPerPencil = 1;
+   
+   // Compute spatial neighbors for target cells.
+   // For targets we need the local cells, plus a padding of 1 cell at both ends
+   phiprof::start("computeSpatialTargetCellsForPencils");
+   cache.targetCells.assign(pencils.sumOfLengths + pencils.N * 2 * nTargetNeighborsPerPencil, NULL);
+   computeSpatialTargetCellsForPencils(mpiGrid, pencils, dimension, cache.targetCells.data());
+   phiprof::stop("computeSpatialTargetCellsForPencils");
+
+   // Compute spatial neighbors for the source cells of the pencils. In
+   // source cells we have a wider stencil and take into account boundaries.
+   phiprof::start("computeSpatialSourceCellsForPencils");
+   cache.pencilSourceCells.assign(pencils.N, std::vector<SpatialCell*>());
+   cache.pencildz.assign(pencils.N, std::vector<Vec, aligned_allocator<Vec,WID3>>());
+#pragma omp parallel for schedule(guided)
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      cuint sourceLength = pencils.lengthOfPencils[pencili] + 2 * VLASOV_STENCIL_WIDTH;
+      std::vector<SpatialCell*>& sourceCells = cache.pencilSourceCells[pencili];
+      sourceCells.assign(sourceLength, NULL);
+      computeSpatialSourceCellsForPencil(mpiGrid, pencils, pencili, dimension, sourceCells.data());
+
+      // dz is the cell size in the direction of the pencil
+      std::vector<Vec, aligned_allocator<Vec,WID3>>& dz = cache.pencildz[pencili];
+      dz.resize(sourceLength);
+      for(uint i = 0; i < sourceLength; ++i) {
+         dz[i] = sourceCells[i]->parameters[CellParams::DX+dimension];
+      }
+   }
+   phiprof::stop("computeSpatialSourceCellsForPencils");
+
+   phiprof::start("classifyPencils");
+   // A pencil is a boundary pencil if one of its source cells is remote, or is a local
+   // cell whose data is sent to other processes. Pencils that share cells are updated
+   // together, so a boundary pencil makes every pencil connected to it a boundary pencil.
+   const int neighborhood = getNeighborhood(dimension,VLASOV_STENCIL_WIDTH);
+   std::unordered_set<SpatialCell*> processBoundaryCellPointers;
+   for (auto id : mpiGrid.get_local_cells_on_process_boundary(neighborhood)) {
+      processBoundaryCellPointers.insert(mpiGrid[id]);
+   }
+   for (auto id : mpiGrid.get_remote_cells_on_process_boundary(neighborhood)) {
+      processBoundaryCellPointers.insert(mpiGrid[id]);
+   }
+   
+   // Union-find over pencils, connected through shared source cells
+   std::vector<uint> pencilGroup(pencils.N);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      pencilGroup[pencili] = pencili;
+   }
+   auto findGroup = [&pencilGroup](uint pencili) {
+      while (pencilGroup[pencili] != pencili) {
+         pencilGroup[pencili] = pencilGroup[pencilGroup[pencili]];
+         pencili = pencilGroup[pencili];
+      }
+      return pencili;
+   };
+   std::unordered_map<SpatialCell*,uint> cellPencil;
+   std::vector<bool> groupIsBoundary(pencils.N, false);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      for (auto *cell : cache.pencilSourceCells[pencili]) {
+         if (processBoundaryCellPointers.count(cell) > 0) {
+            groupIsBoundary[pencili] = true;
+         }
+         auto it = cellPencil.find(cell);
+         if (it == cellPencil.end()) {
+            cellPencil[cell] = pencili;
+         } else {
+            pencilGroup[findGroup(pencili)] = findGroup(it->second);
+         }
+      }
+   }
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      if (groupIsBoundary[pencili]) {
+         groupIsBoundary[findGroup(pencili)] = true;
+      }
+   }
+   cache.isBoundaryPencil.resize(pencils.N);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      cache.isBoundaryPencil[pencili] = groupIsBoundary[findGroup(pencili)];
+   }
+
+   // Split the inner pencils into thirds of whole groups, so that they can be mapped in parts
+   // while the different transfers of the dimension are in flight
+   uint nInnerPencils = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      if (!cache.isBoundaryPencil[pencili]) nInnerPencils++;
+   }
+   const uint8_t unassigned = 3;
+   std::vector<uint8_t> groupPart(pencils.N, unassigned);
+   uint nAssigned = 0;
+   cache.innerPart.assign(pencils.N, 0);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      if (cache.isBoundaryPencil[pencili]) continue;
+      uint8_t& part = groupPart[findGroup(pencili)];
+      if (part == unassigned) {
+         part = min(2u, 3 * nAssigned / nInnerPencils);
+      }
+      cache.innerPart[pencili] = part;
+      nAssigned++;
+   }
+   phiprof::stop("classifyPencils");
+
+   cache.pencils = pencils;
+   cache.valid = true;
+}
+
+/* Get the sorted list of velocity block global ids that exist in any of the given cells.
+ * Each thread sorts and uniques the blocks of its share of the cells, after which the
+ * thread lists are merged pairwise in parallel, log2(nThreads) rounds.
+ *
+ * @param [in] cells List of cells
+ * @param [in] popID Particle population ID
+ * @param [out] unionOfBlocks Sorted list of unique block global ids
+ */
+void getSortedUnionOfBlocks(const std::vector<SpatialCell*>& cells,
+                            const uint popID,
+                            std::vector<vmesh::GlobalID>& unionOfBlocks) {
+   unionOfBlocks.clear();
+
+   std::vector<std::vector<vmesh::GlobalID>> threadBlocks(omp_get_max_threads());
+
+#pragma omp parallel
+   {
+      const int thread = omp_get_thread_num();
+      const int nThreads = omp_get_num_threads();
+      std::vector<vmesh::GlobalID>& blocks = threadBlocks[thread];
+
+#pragma omp for schedule(dynamic,1) nowait
+      for(uint celli = 0; celli < cells.size(); ++celli) {
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& cvmesh = cells[celli]->get_velocity_mesh(popID);
+         for (vmesh::LocalID block_i=0; block_i< cvmesh.size(); ++block_i) {
+            blocks.push_back(cvmesh.getGlobalID(block_i));
+         }
+      }
+      std::sort(blocks.begin(), blocks.end());
+      blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+      // Merge the list of thread + stride into the list of thread
+      std::vector<vmesh::GlobalID> merged;
+      for(int stride = 1; stride < nThreads; stride *= 2) {
+#pragma omp barrier
+         if (thread % (2 * stride) == 0 && thread + stride < nThreads) {
+            std::vector<vmesh::GlobalID>& other = threadBlocks[thread + stride];
+            merged.resize(blocks.size() + other.size());
+            auto end = std::set_union(blocks.begin(), blocks.end(), other.begin(), other.end(), merged.begin());
+            merged.resize(end - merged.begin());
+            blocks.swap(merged);
+            std::vector<vmesh::GlobalID>().swap(other);
+         }
+      }
+   }
+
+   unionOfBlocks.swap(threadBlocks[0]);
+}
+
+/* Build the velocity block list of one dimension and the pencils of each block, for all
+ * pencils of the dimension.
+ *
+ * @param [in] cells Propagated and remote target cells
+ * @param [in] cache Pencil cache of the dimension
+ * @param [in] popID Particle population ID
+ * @param [out] blockCache Block lists of the dimension
+ */
+static void buildPencilBlockCache(const std::vector<SpatialCell*>& cells,
+                                  const PencilCache& cache,
+                                  const uint popID,
+                                  PencilBlockCache& blockCache) {
+   const setOfPencils& pencils = cache.pencils;
+
+   phiprof::start("buildBlockList");
+   // Get a unique sorted list of blockids that are in any of the
+   // propagated cells. A sorted list keeps neighboring blocks in the
+   // same thread in the threaded loop over blocks in trans_map_1d_amr.
+   std::vector<vmesh::GlobalID>& unionOfBlocks = blockCache.unionOfBlocks;
+   getSortedUnionOfBlocks(cells, popID, unionOfBlocks);
+   phiprof::stop("buildBlockList");
+
+   phiprof::start("buildPencilBlockLists");
+   // Index of each block in unionOfBlocks
+   vmesh::HashMap<vmesh::GlobalID,uint> unionIndex;
+   unionIndex.reserve(unionOfBlocks.size());
+   for (uint blocki = 0; blocki < unionOfBlocks.size(); ++blocki) {
+      unionIndex.insert(std::make_pair(unionOfBlocks[blocki], blocki));
+   }
+
+   // Indices in unionOfBlocks of the blocks that exist in any of the source cells of each pencil.
+   // A block that is in none of the source cells of a pencil cannot be propagated by it.
+   // The pencils of each group of each block are counted at the same time.
+   std::vector<std::vector<uint>> pencilBlocks(pencils.N);
+   std::vector<uint>& blockPencilsStart = blockCache.blockPencilsStart;
+   blockPencilsStart.assign(unionOfBlocks.size() * nPencilGroups + 1, 0);
+#pragma omp parallel
+   {
+      std::vector<vmesh::GlobalID> blocks;
+#pragma omp for schedule(guided)
+      for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+         cuint group = getPencilGroup(cache, pencili);
+         blocks.clear();
+         for (auto *cell : cache.pencilSourceCells[pencili]) {
+            const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& cvmesh = cell->get_velocity_mesh(popID);
+            for (vmesh::LocalID block_i=0; block_i< cvmesh.size(); ++block_i) {
+               blocks.push_back(cvmesh.getGlobalID(block_i));
+            }
+         }
+         std::sort(blocks.begin(), blocks.end());
+         blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+         std::vector<uint>& indices = pencilBlocks[pencili];
+         indices.reserve(blocks.size());
+         for (auto blockGID : blocks) {
+            auto it = unionIndex.find(blockGID);
+            if (it != unionIndex.end()) {
+               indices.push_back(it->second * nPencilGroups + group);
+#pragma omp atomic
+               blockPencilsStart[it->second * nPencilGroups + group + 1]++;
+            }
+         }
+      }
+   }
+
+   // Invert the per-pencil lists into a list of pencils for each group of each block in unionOfBlocks with a
+   // prefix sum of the counts. The pencils of group g of block unionOfBlocks[i] are
+   // blockPencils[blockPencilsStart[i*nPencilGroups+g]...blockPencilsStart[i*nPencilGroups+g+1]-1], filled in
+   // pencil order so that the pencils are always summed to the target cells in the same order.
+   for (uint blockGroup = 0; blockGroup < unionOfBlocks.size() * nPencilGroups; ++blockGroup) {
+      blockPencilsStart[blockGroup + 1] += blockPencilsStart[blockGroup];
+   }
+   std::vector<uint>& blockPencils = blockCache.blockPencils;
+   blockPencils.resize(blockPencilsStart.back());
+   std::vector<uint> blockPencilsFill(blockPencilsStart.begin(), blockPencilsStart.end() - 1);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      for (auto blockGroup : pencilBlocks[pencili]) {
+         blockPencils[blockPencilsFill[blockGroup]++] = pencili;
+      }
+   }
+   phiprof::stop("buildPencilBlockLists");
+
+   blockCache.valid = true;
+   blockCache.popID = popID;
+}
+
 /* Map velocity blocks in all local cells forward by one time step in one spatial dimension.
  * This function uses 1-cell wide pencils to update cells in-place to avoid allocating large
- * temporary buffers.
+ * temporary buffers. Pencils are cached per dimension and only rebuilt when the mesh has
+ * been repartitioned (Parameters::meshRepartitioned).
  *
  * @param [in] mpiGrid DCCRG grid object
  * @param [in] localPropagatedCells List of local cells that get propagated
@@ -978,6 +1396,8 @@ void printPencilsFunc(const setOfPencils& pencils, const uint dimension, const i
  * @param dimension Spatial dimension
  * @param [in] dt Time step
  * @param [in] popId Particle population ID
+ * @param [in] cellSet Which pencils to map, see translationset. Inner pencils share no
+ * cells with pencils that read remote data or write data sent to other processes.
  */
 bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                       const vector<CellID>& localPropagatedCells,
@@ -985,11 +1405,11 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                       std::vector<uint>& nPencils,
                       const uint dimension,
                       const Realv dt,
-                      const uint popID) {
+                      const uint popID,
+                      const uint cellSet) {
    
    phiprof::start("setup");
 
-   const bool printPencils = false;
    uint cell_indices_to_id[3]; /*< used when computing id of target cell in block*/
    unsigned char  cellid_transpose[WID3]; /*< defines the transpose for the solver internal (transposed) id: i + j*WID + k*WID2 to actual one*/
    // return if there's no cells to propagate
@@ -998,9 +1418,6 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       return false;
    }
 
-   int myRank;
-   if(printPencils) MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
-   
    // Vector with all cell ids
    vector<CellID> allCells(localPropagatedCells);
    allCells.insert(allCells.end(), remoteTargetCells.begin(), remoteTargetCells.end());  
@@ -1042,167 +1459,101 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       abort();
       break;
    }
-           
-   // ****************************************************************************
-
-   // compute pencils => set of pencils (shared datastructure)
-   
-   phiprof::start("getSeedIds");
-   vector<CellID> seedIds;
-   getSeedIds(mpiGrid, localPropagatedCells, dimension, seedIds);
-   phiprof::stop("getSeedIds");
-   
-   phiprof::start("buildPencils");
 
-   // Output vectors for ready pencils
-   setOfPencils pencils;
-   
-#pragma omp parallel
-   {
-      // Empty vectors for internal use of buildPencilsWithNeighbors. Could be default values but
-      // default vectors are complicated. Should overload buildPencilsWithNeighbors like suggested here
-      // https://stackoverflow.com/questions/3147274/c-default-argument-for-vectorint
-      vector<CellID> ids;
-      vector<uint> path;
-      // thread-internal pencil set to be accumulated at the end
-      setOfPencils thread_pencils;
-      // iterators used in the accumulation
-      std::vector<CellID>::iterator ibeg, iend;
-      
-#pragma omp for schedule(guided)
-      for (uint i=0; i<seedIds.size(); i++) {
-         cuint seedId = seedIds[i];
-         // Construct pencils from the seedIds into a set of pencils.
-         thread_pencils = buildPencilsWithNeighbors(mpiGrid, thread_pencils, seedId, ids, dimension, path, seedIds);
-      }
-      
-      // accumulate thread results in global set of pencils
-#pragma omp critical
-      {
-         for (uint i=0; i<thread_pencils.N; i++) {
-            // Use vector range constructor
-            ibeg = thread_pencils.ids.begin() + thread_pencils.idsStart[i];
-            iend = ibeg + thread_pencils.lengthOfPencils[i];
-            std::vector<CellID> pencilIds(ibeg, iend);
-            pencils.addPencil(pencilIds,thread_pencils.x[i],thread_pencils.y[i],thread_pencils.periodic[i],thread_pencils.path[i]);
-         }
-      }
-
-      // init cellid_transpose (moved here to take advantage of the omp parallel region)
-#pragma omp for collapse(3)
-      for (uint k=0; k<WID; ++k) {
-         for (uint j=0; j<WID; ++j) {
-            for (uint i=0; i<WID; ++i) {
-               const uint cell =
-                  i * cell_indices_to_id[0] +
-                  j * cell_indices_to_id[1] +
-                  k * cell_indices_to_id[2];
-               cellid_transpose[ i + j * WID + k * WID2] = cell;
-            }
+   // init cellid_transpose
+   for (uint k=0; k<WID; ++k) {
+      for (uint j=0; j<WID; ++j) {
+         for (uint i=0; i<WID; ++i) {
+            const uint cell =
+               i * cell_indices_to_id[0] +
+               j * cell_indices_to_id[1] +
+               k * cell_indices_to_id[2];
+            cellid_transpose[ i + j * WID + k * WID2] = cell;
          }
       }
    }
-   
-   // Check refinement of two ghost cells on each end of each pencil
-   check_ghost_cells(mpiGrid,pencils,dimension);
-   // ****************************************************************************   
-
-   if(printPencils) printPencilsFunc(pencils,dimension,myRank);
+           
+   // ****************************************************************************
 
-   if(!checkPencils(mpiGrid, localPropagatedCells, pencils)) {
-      abort();
+   // compute pencils => set of pencils (shared datastructure). Pencils only
+   // change when the mesh is repartitioned, otherwise the cached ones are used.
+   PencilCache& cache = pencilCache[dimension];
+   // The first set mapped in a dimension updates the cache, the other sets of the dimension use it as is
+   const bool firstCellSet = (cellSet == translationset::ALL || cellSet == translationset::INNER ||
+                              cellSet == translationset::INNER_1);
+   if ((Parameters::meshRepartitioned && firstCellSet) || !cache.valid) {
+      buildPencilCache(mpiGrid, localPropagatedCells, dimension, cache);
    }
+   const setOfPencils& pencils = cache.pencils;
+   const std::vector<SpatialCell*>& targetCells = cache.targetCells;
+   std::vector<std::vector<SpatialCell*>>& pencilSourceCells = cache.pencilSourceCells;
+   std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>>& pencildz = cache.pencildz;
    
-   if (Parameters::prepareForRebalance == true) {
+   // Count the pencils once per dimension, also when mapping them in two parts
+   if (Parameters::prepareForRebalance == true && firstCellSet) {
       for (uint i=0; i<localPropagatedCells.size(); i++) {
-         cuint myPencilCount = std::count(pencils.ids.begin(), pencils.ids.end(), localPropagatedCells[i]);
+         cuint myPencilCount = cache.nPencilsThroughCell[i];
          nPencils[i] += myPencilCount;
          nPencils[nPencils.size()-1] += myPencilCount;
       }
    }
-   phiprof::stop("buildPencils");
    
    // Get a pointer to the velocity mesh of the first spatial cell
    const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = allCellsPointer[0]->get_velocity_mesh(popID);
    
-   phiprof::start("buildBlockList");
-   // Get a unique sorted list of blockids that are in any of the
-   // propagated cells. First use set for this, then add to vector (may not
-   // be the most nice way to do this and in any case we could do it along
-   // dimension for data locality reasons => copy acc map column code, TODO: FIXME
-   // TODO: Do this separately for each pencil?
-   std::unordered_set<vmesh::GlobalID> unionOfBlocksSet;
-   
-   for(auto cell : allCellsPointer) {
-      vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& cvmesh = cell->get_velocity_mesh(popID);
-      for (vmesh::LocalID block_i=0; block_i< cvmesh.size(); ++block_i) {
-         unionOfBlocksSet.insert(cvmesh.getGlobalID(block_i));
-      }
-   }
-   
-   std::vector<vmesh::GlobalID> unionOfBlocks;
-   unionOfBlocks.reserve(unionOfBlocksSet.size());
-   for(const auto blockGID:  unionOfBlocksSet) {
-      unionOfBlocks.push_back(blockGID);
+   // The blocks and their pencils are listed for all pencils by the first set of the dimension
+   PencilBlockCache& blockCache = pencilBlockCache[dimension];
+   if (firstCellSet || !blockCache.valid || blockCache.popID != popID) {
+      buildPencilBlockCache(allCellsPointer, cache, popID, blockCache);
    }
-   phiprof::stop("buildBlockList");
+   const std::vector<vmesh::GlobalID>& unionOfBlocks = blockCache.unionOfBlocks;
+   const std::vector<uint>& blockPencilsStart = blockCache.blockPencilsStart;
+   const std::vector<uint>& blockPencils = blockCache.blockPencils;
+   uint firstGroup, endGroup;
+   getCellSetGroups(cellSet, firstGroup, endGroup);
    // ****************************************************************************
    
    // Assuming 1 neighbor in the target array because of the CFL condition
    // In fact propagating to > 1 neighbor will give an error
    const uint nTargetNeighborsPerPencil = 1;
-   
-   // Compute spatial neighbors for target cells.
-   // For targets we need the local cells, plus a padding of 1 cell at both ends
-   phiprof::start("computeSpatialTargetCellsForPencils");
-   std::vector<SpatialCell*> targetCells(pencils.sumOfLengths + pencils.N * 2 * nTargetNeighborsPerPencil );
-   computeSpatialTargetCellsForPencils(mpiGrid, pencils, dimension, targetCells.data());
-   phiprof::stop("computeSpatialTargetCellsForPencils");
-   
+
+   // Offsets of the pencils in targetCells and targetBlockData
+   std::vector<uint> pencilTargetStart(pencils.N);
+   uint totalTargetLength = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      pencilTargetStart[pencili] = totalTargetLength;
+      totalTargetLength += pencils.lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+   }
    
    phiprof::stop("setup");
    
    int t1 = phiprof::initializeTimer("mapping");
    int t2 = phiprof::initializeTimer("store");
    
+   uint maxPencilLength = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      maxPencilLength = max(maxPencilLength, pencils.lengthOfPencils[pencili]);
+   }
+   if (pencilScratch.size() < (size_t)omp_get_max_threads()) {
+      pencilScratch.resize(omp_get_max_threads());
+   }
+   
 #pragma omp parallel
    {
-      // declarations for variables needed by the threads
-      std::vector<Realf, aligned_allocator<Realf, WID3>> targetBlockData((pencils.sumOfLengths + 2 * nTargetNeighborsPerPencil * pencils.N) * WID3);
-      std::vector<std::vector<SpatialCell*>> pencilSourceCells;
+      PencilScratch& scratch = pencilScratch[omp_get_thread_num()];
       
-      // Allocate aligned vectors which are needed once per pencil to avoid reallocating once per block loop + pencil loop iteration
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencilTargetValues;
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencilSourceVecData;
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencildz;
-      
-      for(uint pencili = 0; pencili < pencils.N; ++pencili) {
-         
-         cint L = pencils.lengthOfPencils[pencili];
-         cuint sourceLength = L + 2 * VLASOV_STENCIL_WIDTH;
-         
-         // Vector buffer where we write data, initialized to 0*/
-         std::vector<Vec, aligned_allocator<Vec,WID3>> targetValues((L + 2 * nTargetNeighborsPerPencil) * WID3 / VECL);
-         pencilTargetValues.push_back(targetValues);
-         // Allocate source data: sourcedata<length of pencil * WID3)
-         // Add padding by 2 * VLASOV_STENCIL_WIDTH
-         std::vector<Vec, aligned_allocator<Vec,WID3>> sourceVecData(sourceLength * WID3 / VECL);
-         pencilSourceVecData.push_back(sourceVecData);
-
-         // Compute spatial neighbors for the source cells of the pencil. In
-         // source cells we have a wider stencil and take into account boundaries.
-         std::vector<SpatialCell*> sourceCells(sourceLength);
-         //                std::vector<CellID> sourceCellIds(sourceLength);
-         computeSpatialSourceCellsForPencil(mpiGrid, pencils, pencili, dimension, sourceCells.data()/*, sourceCellIds*/);
-         pencilSourceCells.push_back(sourceCells);
-
-         // dz is the cell size in the direction of the pencil
-         std::vector<Vec, aligned_allocator<Vec,WID3>> dz(sourceLength);
-         for(uint i = 0; i < sourceCells.size(); ++i) {
-            dz[i] = sourceCells[i]->parameters[CellParams::DX+dimension];
-         }
-         pencildz.push_back(dz);
+      // Vector buffer where we write data, initialized to 0 in propagatePencil
+      if (scratch.targetValues.size() < (maxPencilLength + 2 * nTargetNeighborsPerPencil) * WID3 / VECL) {
+         scratch.targetValues.resize((maxPencilLength + 2 * nTargetNeighborsPerPencil) * WID3 / VECL);
       }
+      // Source data padded by 2 * VLASOV_STENCIL_WIDTH
+      if (scratch.sourceVecData.size() < (maxPencilLength + 2 * VLASOV_STENCIL_WIDTH) * WID3 / VECL) {
+         scratch.sourceVecData.resize((maxPencilLength + 2 * VLASOV_STENCIL_WIDTH) * WID3 / VECL);
+      }
+      Vec* sourceVecData = scratch.sourceVecData.data();
+      Vec* targetValues = scratch.targetValues.data();
+      std::vector<Realf, aligned_allocator<Realf,WID3>>& targetBlockData = scratch.targetBlockData;
+      std::vector<uint>& targetBlockStart = scratch.targetBlockStart;
       
       // Loop over velocity space blocks. Thread this loop (over vspace blocks) with OpenMP.
 #pragma omp for schedule(guided)
@@ -1211,29 +1562,49 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
          // Get global id of the velocity block
          vmesh::GlobalID blockGID = unionOfBlocks[blocki];
 
+            // Pencils of this block in cellSet, the other pencils are left untouched
+            const uint* setPencils = blockPencils.data() + blockPencilsStart[blocki * nPencilGroups + firstGroup];
+            cuint nBlockPencils = blockPencilsStart[blocki * nPencilGroups + endGroup] - blockPencilsStart[blocki * nPencilGroups + firstGroup];
+            if (nBlockPencils == 0) {
+               continue;
+            }
+
             phiprof::start(t1);
             
-            // Loop over pencils
-            uint totalTargetLength = 0;
-            for(uint pencili = 0; pencili < pencils.N; ++pencili){
-//             for ( auto pencili : unionOfBlocksMapToPencilIds.at(blockGID) ) {
+            // Pack the target data of the pencils of this block one after another
+            targetBlockStart.resize(nBlockPencils + 1);
+            targetBlockStart[0] = 0;
+            for(uint i = 0; i < nBlockPencils; ++i) {
+               cuint pencili = setPencils[i];
+               targetBlockStart[i + 1] = targetBlockStart[i] + pencils.lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+            }
+            if (targetBlockData.size() < targetBlockStart[nBlockPencils] * WID3) {
+               targetBlockData.resize(targetBlockStart[nBlockPencils] * WID3);
+            }
+            
+            // Loop over the pencils that have this block in any of their source cells
+            for(uint i = 0; i < nBlockPencils; ++i) {
                
+               cuint pencili = setPencils[i];
                int L = pencils.lengthOfPencils[pencili];
                uint targetLength = L + 2 * nTargetNeighborsPerPencil;
-               uint sourceLength = L + 2 * VLASOV_STENCIL_WIDTH;
+               uint targetStart = targetBlockStart[i];
                               
                // load data(=> sourcedata) / (proper xy reconstruction in future)
-               bool pencil_has_data = copy_trans_block_data_amr(pencilSourceCells[pencili].data(), blockGID, L, pencilSourceVecData[pencili].data(),
+               bool pencil_has_data = copy_trans_block_data_amr(pencilSourceCells[pencili].data(), blockGID, L, sourceVecData,
                                          cellid_transpose, popID);
 
                if(!pencil_has_data) {
-                  totalTargetLength += targetLength;
+                  // The buffer is reused, clear what a previous block left here
+                  for (uint j = targetStart * WID3; j < (targetStart + targetLength) * WID3; ++j) {
+                     targetBlockData[j] = 0.0;
+                  }
                   continue;
                }
 
                // Dz and sourceVecData are both padded by VLASOV_STENCIL_WIDTH
                // Dz has 1 value/cell, sourceVecData has WID3 values/cell
-               propagatePencil(pencildz[pencili].data(), pencilSourceVecData[pencili].data(), pencilTargetValues[pencili].data(), dimension, blockGID, dt, vmesh, L, pencilSourceCells[pencili][0]->getVelocityBlockMinValue(popID));
+               propagatePencil(pencildz[pencili].data(), sourceVecData, targetValues, dimension, blockGID, dt, vmesh, L, pencilSourceCells[pencili][0]->getVelocityBlockMinValue(popID));
 
                // sourceVecData => targetBlockData[this pencil])
 
@@ -1246,45 +1617,53 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
 
                         // Unpack the vector data
                         Realf vector[VECL];
-                        pencilSourceVecData[pencili][i_trans_ps_blockv_pencil(planeVector, k, icell - 1, L)].store(vector);
+                        sourceVecData[i_trans_ps_blockv_pencil(planeVector, k, icell - 1, L)].store(vector);
                         
                         // Loop over 3rd (vectorized) vspace dimension
                         for (uint iv = 0; iv < VECL; iv++) {
 
                            // Store vector data in target data array.
-                           targetBlockData[(totalTargetLength + icell) * WID3 +
+                           targetBlockData[(targetStart + icell) * WID3 +
                                            cellid_transpose[iv + planeVector * VECL + k * WID2]]
                               = vector[iv];
                         }
                      }
                   }
                }
-               totalTargetLength += targetLength;
                
-            } // Closes loop over pencils. SourceVecData gets implicitly deallocated here.
+            } // Closes loop over pencils
 
             phiprof::stop(t1);
             phiprof::start(t2);
             
             // reset blocks in all non-sysboundary neighbor spatial cells for this block id
-            // At this point the block data is saved in targetBlockData so we can reset the spatial cells
+            // At this point the block data is saved in targetBlockData so we can reset the spatial cells.
+            // Target cells of pencils that do not have this block cannot have it either.
+            for(uint i = 0; i < nBlockPencils; ++i) {
 
-            for (auto *spatial_cell: targetCells) {
-               // Check for null and system boundary
-               if (spatial_cell && spatial_cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) {
+               cuint pencili = setPencils[i];
+               uint targetLength = pencils.lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+               uint targetStart = pencilTargetStart[pencili];
+
+               for ( uint celli = 0; celli < targetLength; celli++ ) {
+                  SpatialCell* spatial_cell = targetCells[targetStart + celli];
                   
-                  // Get local velocity block id
-                  const vmesh::LocalID blockLID = spatial_cell->get_velocity_block_local_id(blockGID, popID);
+                  // Check for null and system boundary
+                  if (spatial_cell && spatial_cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) {
                   
-                  // Check for invalid block id
-                  if (blockLID != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
+                     // Get local velocity block id
+                     const vmesh::LocalID blockLID = spatial_cell->get_velocity_block_local_id(blockGID, popID);
                      
-                     // Get a pointer to the block data
-                     Realf* blockData = spatial_cell->get_data(blockLID, popID);
-                     
-                     // Loop over velocity block cells
-                     for(int i = 0; i < WID3; i++) {
-                        blockData[i] = 0.0;
+                     // Check for invalid block id
+                     if (blockLID != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
+                        
+                        // Get a pointer to the block data
+                        Realf* blockData = spatial_cell->get_data(blockLID, popID);
+                        
+                        // Loop over velocity block cells
+                        for(int i = 0; i < WID3; i++) {
+                           blockData[i] = 0.0;
+                        }
                      }
                   }
                }
@@ -1292,16 +1671,18 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
 
             // store_data(target_data => targetCells)  :Aggregate data for blockid to original location 
             // Loop over pencils again
-            totalTargetLength = 0;
-            for(uint pencili = 0; pencili < pencils.N; pencili++){
+            for(uint i = 0; i < nBlockPencils; ++i) {
                
+               cuint pencili = setPencils[i];
                uint targetLength = pencils.lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+               uint targetStart = pencilTargetStart[pencili];
                
                // store values from targetBlockData array to the actual blocks
                // Loop over cells in the pencil, including the padded cells of the target array
                for ( uint celli = 0; celli < targetLength; celli++ ) {
                   
-                  uint GID = celli + totalTargetLength; 
+                  uint GID = celli + targetStart; 
+                  uint dataOffset = (celli + targetBlockStart[i]) * WID3;
                   SpatialCell* targetCell = targetCells[GID];
 
                   if(targetCell) {
@@ -1328,12 +1709,10 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                      }
                      
                      for(int i = 0; i < WID3 ; i++) {
-                        blockData[i] += targetBlockData[GID * WID3 + i] * areaRatio;
+                        blockData[i] += targetBlockData[dataOffset + i] * areaRatio;
                      }
                   }
                }
-
-               totalTargetLength += targetLength;
                
             } // closes loop over pencils
 
@@ -1373,7 +1752,35 @@ int get_sibling_index(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
    
 }
 
-/* This function communicates the mapping on process boundaries, and then updates the data to their correct values.
+/* Pool of buffers for the block data received, or sent as zeros, in
+ * start_remote_mapping_contribution_amr. Buffers are handed out in order
+ * during one exchange and reused by the next, growing when needed. The pool
+ * is emptied after the mesh is repartitioned, so that buffers sized for an
+ * earlier, larger process boundary do not stay allocated.
+ */
+static std::vector<std::vector<Realf, aligned_allocator<Realf,WID3>>> remoteMappingBuffers;
+static uint nUsedRemoteMappingBuffers = 0;
+static uint remoteMappingBuffersRepartition = 0; // Parameters::meshRepartitionCount when the pool was last emptied
+
+/* Get the next unused buffer from the pool.
+ *
+ * @param size Number of Realf elements needed
+ * @return Pointer to the buffer, valid until the next call to start_remote_mapping_contribution_amr
+ */
+Realf* getRemoteMappingBuffer(const size_t size) {
+   if (nUsedRemoteMappingBuffers == remoteMappingBuffers.size()) {
+      remoteMappingBuffers.emplace_back();
+   }
+   std::vector<Realf, aligned_allocator<Realf,WID3>>& buffer = remoteMappingBuffers[nUsedRemoteMappingBuffers++];
+   if (buffer.size() < size) {
+      buffer.resize(size);
+   }
+   return buffer.data();
+}
+
+/* This function starts communicating the mapping on process boundaries, finish_remote_mapping_contribution_amr
+ * then updates the data to their correct values. Local work that does not touch the cells on the process
+ * boundary can be done in between.
  * When sending data between neighbors of different refinement levels, special care has to be taken to ensure that
  * The sending and receiving ranks allocate the correct size arrays for neighbor_block_data.
  * This is partially due to DCCRG defining neighborhood size relative to the host cell. For details, see 
@@ -1383,22 +1790,29 @@ int get_sibling_index(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
  * @param dimension Spatial dimension
  * @param direction Direction of communication (+ or -)
  * @param popId Particle population ID
+ * @param exchange State of the transfer, passed on to finish_remote_mapping_contribution_amr
  */
-void update_remote_mapping_contribution_amr(
+void start_remote_mapping_contribution_amr(
    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    const uint dimension,
    int direction,
-   const uint popID) {
+   const uint popID,
+   RemoteMappingExchange& exchange) {
    
    vector<CellID> local_cells = mpiGrid.get_cells();
    const vector<CellID> remote_cells = mpiGrid.get_remote_cells_on_process_boundary(VLASOV_SOLVER_NEIGHBORHOOD_ID);
-   vector<CellID> receive_cells;
-   set<CellID> send_cells;
+   vector<CellID>& receive_cells = exchange.receive_cells;
+   set<CellID>& send_cells = exchange.send_cells;
    
-   vector<CellID> receive_origin_cells;
-   vector<uint> receive_origin_index;
-
-   int neighborhood = 0;
+   vector<CellID>& receive_origin_cells = exchange.receive_origin_cells;
+   vector<uint>& receive_origin_index = exchange.receive_origin_index;
+   receive_cells.clear();
+   send_cells.clear();
+   receive_origin_cells.clear();
+   receive_origin_index.clear();
+
+   int& neighborhood = exchange.neighborhood;
+   neighborhood = 0;
    
    //normalize and set neighborhoods
    if(direction > 0) {
@@ -1441,7 +1855,9 @@ void update_remote_mapping_contribution_amr(
       // We need the default for 1 to 1 communications
       if(ccell) {
          for (uint i = 0; i < MAX_NEIGHBORS_PER_DIM; ++i) {
-            ccell->neighbor_block_data.at(i) = ccell->get_data(popID);
+            // Only an address for the empty transfer, taken through const access so that
+            // blocks shared with a template cell are not copied
+            ccell->neighbor_block_data.at(i) = const_cast<Realf*>(static_cast<const SpatialCell*>(ccell)->get_data(popID));
             ccell->neighbor_number_of_blocks[i] = 0;
          }
       }
@@ -1453,14 +1869,20 @@ void update_remote_mapping_contribution_amr(
       if(ccell) {
          // Initialize number of blocks to 0 and neighbor block data pointer to the local block data pointer
          for (uint i = 0; i < MAX_NEIGHBORS_PER_DIM; ++i) {
-            ccell->neighbor_block_data.at(i) = ccell->get_data(popID);
+            // Only an address for the empty transfer, taken through const access so that
+            // blocks shared with a template cell are not copied
+            ccell->neighbor_block_data.at(i) = const_cast<Realf*>(static_cast<const SpatialCell*>(ccell)->get_data(popID));
             ccell->neighbor_number_of_blocks[i] = 0;
          }
       }
    }
    
-   vector<Realf*> receiveBuffers;
-   vector<Realf*> sendBuffers;
+   // Buffers handed out in the previous exchange are free again
+   if (remoteMappingBuffersRepartition != Parameters::meshRepartitionCount) {
+      std::vector<std::vector<Realf, aligned_allocator<Realf,WID3>>>().swap(remoteMappingBuffers);
+      remoteMappingBuffersRepartition = Parameters::meshRepartitionCount;
+   }
+   nUsedRemoteMappingBuffers = 0;
    
    for (auto c : local_cells) {
       
@@ -1535,8 +1957,7 @@ void update_remote_mapping_contribution_amr(
                      // summed for the correct result.
                      
                      ccell->neighbor_block_data.at(sendIndex) =
-                        (Realf*) aligned_malloc(ccell->neighbor_number_of_blocks.at(sendIndex) * WID3 * sizeof(Realf), 64);
-                     sendBuffers.push_back(ccell->neighbor_block_data.at(sendIndex));
+                        getRemoteMappingBuffer(ccell->neighbor_number_of_blocks.at(sendIndex) * WID3);
                      for (uint j = 0; j < ccell->neighbor_number_of_blocks.at(sendIndex) * WID3; ++j) {
                         ccell->neighbor_block_data.at(sendIndex)[j] = 0.0;
                         
@@ -1586,8 +2007,7 @@ void update_remote_mapping_contribution_amr(
 
                   ncell->neighbor_number_of_blocks.at(recvIndex) = ccell->get_number_of_velocity_blocks(popID);
                   ncell->neighbor_block_data.at(recvIndex) =
-                     (Realf*) aligned_malloc(ncell->neighbor_number_of_blocks.at(recvIndex) * WID3 * sizeof(Realf), 64);
-                  receiveBuffers.push_back(ncell->neighbor_block_data.at(recvIndex));
+                     getRemoteMappingBuffer(ncell->neighbor_number_of_blocks.at(recvIndex) * WID3);
                   
                } else {
 
@@ -1611,8 +2031,7 @@ void update_remote_mapping_contribution_amr(
                         
                         ncell->neighbor_number_of_blocks.at(i_sib) = scell->get_number_of_velocity_blocks(popID);
                         ncell->neighbor_block_data.at(i_sib) =
-                           (Realf*) aligned_malloc(ncell->neighbor_number_of_blocks.at(i_sib) * WID3 * sizeof(Realf), 64);
-                        receiveBuffers.push_back(ncell->neighbor_block_data.at(i_sib));
+                           getRemoteMappingBuffer(ncell->neighbor_number_of_blocks.at(i_sib) * WID3);
                      }
                   }
                }
@@ -1629,58 +2048,128 @@ void update_remote_mapping_contribution_amr(
       
    } // closes for (auto c : local_cells) {
 
-   MPI_Barrier(MPI_COMM_WORLD);
-   
-   // Do communication
+   // Do communication. The receiving ranks only need the data of their own
+   // neighbors, so no global synchronization is needed around the transfer.
    SpatialCell::setCommunicatedSpecies(popID);
    SpatialCell::set_mpi_transfer_type(Transfer::NEIGHBOR_VEL_BLOCK_DATA);
-   mpiGrid.update_copies_of_remote_neighbors(neighborhood);
+   mpiGrid.start_remote_neighbor_copy_updates(neighborhood);
+}
 
-   MPI_Barrier(MPI_COMM_WORLD);
-   
-   // Reduce data: sum received data in the data array to 
-   // the target grid in the temporary block container   
-   //#pragma omp parallel
-   {
-      for (size_t c = 0; c < receive_cells.size(); ++c) {
-         SpatialCell* receive_cell = mpiGrid[receive_cells[c]];
-         SpatialCell* origin_cell = mpiGrid[receive_origin_cells[c]];
+/* List one work item for every velocity block of the given cells.
+ *
+ * @param nBlocks Number of velocity blocks in each cell
+ * @param items Index to nBlocks and local block id of each work item
+ */
+static void listBlockWorkItems(const std::vector<vmesh::LocalID>& nBlocks,
+                               std::vector<std::pair<uint,vmesh::LocalID>>& items) {
+   items.clear();
+   for (uint c = 0; c < nBlocks.size(); ++c) {
+      for (vmesh::LocalID block = 0; block < nBlocks[c]; ++block) {
+         items.push_back(std::make_pair(c, block));
+      }
+   }
+}
 
-         if(!receive_cell || !origin_cell) {
-            continue;
-         }
-         
-         Realf *blockData = receive_cell->get_data(popID);
-         Realf *neighborData = origin_cell->neighbor_block_data[receive_origin_index[c]];
+/* Wait for the transfer started by start_remote_mapping_contribution_amr, add the received
+ * contributions to the local cells and zero the sent data.
+ *
+ * @param mpiGrid DCCRG grid object
+ * @param popId Particle population ID
+ * @param exchange State of the transfer, as left by start_remote_mapping_contribution_amr
+ */
+void finish_remote_mapping_contribution_amr(
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   const uint popID,
+   RemoteMappingExchange& exchange) {
 
-         //#pragma omp for 
-         for(uint vCell = 0; vCell < VELOCITY_BLOCK_LENGTH * receive_cell->get_number_of_velocity_blocks(popID); ++vCell) {
-            blockData[vCell] += neighborData[vCell];
-         }
+   int timer=phiprof::initializeTimer("Wait for receives","MPI","Wait");
+   phiprof::start(timer);
+   mpiGrid.wait_remote_neighbor_copy_update_receives(exchange.neighborhood);
+   phiprof::stop(timer);
+   
+   // The contributions to one cell are consecutive in receive_cells. They are all
+   // summed in the work item of the block, so the items can run in any order.
+   std::vector<CellID> receiveCellIDs;
+   std::vector<Realf*> receiveData;
+   std::vector<vmesh::LocalID> receiveBlocks;
+   std::vector<uint> contributionStart(1, 0);
+   std::vector<const Realf*> contributionData;
+   for (size_t c = 0; c < exchange.receive_cells.size(); ++c) {
+      SpatialCell* receive_cell = mpiGrid[exchange.receive_cells[c]];
+      SpatialCell* origin_cell = mpiGrid[exchange.receive_origin_cells[c]];
+
+      if(!receive_cell || !origin_cell) {
+         continue;
       }
-      
-      // send cell data is set to zero. This is to avoid double copy if
-      // one cell is the neighbor on bot + and - side to the same process
-      for (auto c : send_cells) {
-         SpatialCell* spatial_cell = mpiGrid[c];
-         Realf * blockData = spatial_cell->get_data(popID);
-         //#pragma omp for nowait
-         for(unsigned int vCell = 0; vCell < VELOCITY_BLOCK_LENGTH * spatial_cell->get_number_of_velocity_blocks(popID); ++vCell) {
-            // copy received target data to temporary array where target data is stored.
-            blockData[vCell] = 0;
+      if (receiveCellIDs.empty() || receiveCellIDs.back() != exchange.receive_cells[c]) {
+         receiveCellIDs.push_back(exchange.receive_cells[c]);
+         receiveData.push_back(receive_cell->get_data(popID));
+         receiveBlocks.push_back(receive_cell->get_number_of_velocity_blocks(popID));
+         contributionStart.push_back(contributionStart.back());
+      }
+      contributionData.push_back(origin_cell->neighbor_block_data[exchange.receive_origin_index[c]]);
+      contributionStart.back()++;
+   }
+
+   // Reduce data: sum received data in the data array to 
+   // the target grid in the temporary block container. Sends may still be
+   // in progress, they read from send_cells and the zero buffers only.
+   std::vector<std::pair<uint,vmesh::LocalID>> items;
+   listBlockWorkItems(receiveBlocks, items);
+#pragma omp parallel for schedule(static)
+   for (size_t i = 0; i < items.size(); ++i) {
+      const uint c = items[i].first;
+      const size_t offset = items[i].second * WID3;
+      Realf* blockData = receiveData[c] + offset;
+      for (uint n = contributionStart[c]; n < contributionStart[c + 1]; ++n) {
+         const Realf* neighborData = contributionData[n] + offset;
+         #pragma omp simd
+         for (uint vCell = 0; vCell < WID3; ++vCell) {
+            blockData[vCell] += neighborData[vCell];
          }
       }
    }
 
-   for (auto p : receiveBuffers) {
-      aligned_free(p);
+   timer=phiprof::initializeTimer("Wait for sends","MPI","Wait");
+   phiprof::start(timer);
+   mpiGrid.wait_remote_neighbor_copy_update_sends();
+   phiprof::stop(timer);
+
+   // send cell data is set to zero. This is to avoid double copy if
+   // one cell is the neighbor on bot + and - side to the same process
+   std::vector<Realf*> sendData;
+   std::vector<vmesh::LocalID> sendBlocks;
+   for (auto c : exchange.send_cells) {
+      SpatialCell* spatial_cell = mpiGrid[c];
+      sendData.push_back(spatial_cell->get_data(popID));
+      sendBlocks.push_back(spatial_cell->get_number_of_velocity_blocks(popID));
    }
-   for (auto p : sendBuffers) {
-      aligned_free(p);
+   listBlockWorkItems(sendBlocks, items);
+#pragma omp parallel for schedule(static)
+   for (size_t i = 0; i < items.size(); ++i) {
+      Realf* blockData = sendData[items[i].first] + items[i].second * WID3;
+      #pragma omp simd
+      for (uint vCell = 0; vCell < WID3; ++vCell) {
+         blockData[vCell] = 0;
+      }
    }
+}
 
-   // MPI_Barrier(MPI_COMM_WORLD);
-   // cout << "end update_remote_mapping_contribution_amr, dimension = " << dimension << ", direction = " << direction << endl;
-   // MPI_Barrier(MPI_COMM_WORLD);
+/* Communicate the mapping on process boundaries and update the data to their correct values,
+ * without other work in between. See start_remote_mapping_contribution_amr.
+ *
+ * @param mpiGrid DCCRG grid object
+ * @param dimension Spatial dimension
+ * @param direction Direction of communication (+ or -)
+ * @param popId Particle population ID
+ */
+void update_remote_mapping_contribution_amr(
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   const uint dimension,
+   int direction,
+   const uint popID) {
 
+   RemoteMappingExchange exchange;
+   start_remote_mapping_contribution_amr(mpiGrid, dimension, direction, popID, exchange);
+   finish_remote_mapping_contribution_amr(mpiGrid, popID, exchange);
 }
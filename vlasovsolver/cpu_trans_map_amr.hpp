@@ -22,6 +22,7 @@
 #ifndef CPU_TRANS_MAP_AMR_H
 #define CPU_TRANS_MAP_AMR_H
 
+#include <set>
 #include <vector>
 
 #include "vec.h"
@@ -174,9 +175,33 @@ bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartes
                   std::vector<uint>& nPencils,
                   const uint dimension,
                   const Realv dt,
-                  const uint popID);
+                  const uint popID,
+                  const uint cellSet);
 
 
+/* State of a remote mapping contribution transfer between start_remote_mapping_contribution_amr
+ * and finish_remote_mapping_contribution_amr.
+ */
+struct RemoteMappingExchange {
+   int neighborhood;                         // Neighborhood the transfer uses
+   std::vector<CellID> receive_cells;        // Local cell of each received contribution
+   std::vector<CellID> receive_origin_cells; // Remote cell whose neighbor_block_data holds each contribution
+   std::vector<uint> receive_origin_index;   // Index of each contribution in neighbor_block_data
+   std::set<CellID> send_cells;              // Remote cells whose data is sent, zeroed afterwards
+};
+
+void start_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCell,
+                                           dccrg::Cartesian_Geometry>& mpiGrid,
+                                           const uint dimension,
+                                           int direction,
+                                           const uint popID,
+                                           RemoteMappingExchange& exchange);
+
+void finish_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCell,
+                                            dccrg::Cartesian_Geometry>& mpiGrid,
+                                            const uint popID,
+                                            RemoteMappingExchange& exchange);
+
 void update_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCell,
                                             dccrg::Cartesian_Geometry>& mpiGrid,
                                             const uint dimension,
@@ -55,6 +55,163 @@ creal ONE     = 1.0;
 creal TWO     = 2.0;
 creal EPSILON = 1.0e-25;
 
+/** Pack the velocity block data of the local cells that are sent in the given neighborhood,
+    see SpatialCell::compress_block_data. Values below P::compressedTransferCutoff times the
+    sparsity threshold of the species are dropped.
+ */
+void compressStencilData(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const int neighborhood,
+        const uint popID
+) {
+   const vector<CellID> cells = mpiGrid.get_local_cells_on_process_boundary(neighborhood);
+   const Realf cutoff = P::compressedTransferCutoff * getObjectWrapper().particleSpecies[popID].sparseMinValue;
+   #pragma omp parallel for schedule(dynamic,1)
+   for (size_t c=0; c<cells.size(); ++c) {
+      mpiGrid[cells[c]]->compress_block_data(popID,cutoff);
+   }
+}
+
+/** Unpack the compressed velocity block data received to the remote cells of the given neighborhood,
+    and free the packed data of the local cells sent in it. Call once the sends have completed.*/
+void decompressStencilData(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const int neighborhood,
+        const uint popID
+) {
+   const vector<CellID> cells = mpiGrid.get_remote_cells_on_process_boundary(neighborhood);
+   #pragma omp parallel for schedule(dynamic,1)
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (!mpiGrid[cells[c]]->decompress_block_data(popID)) {
+         std::cerr << "ERROR: compressed block data of remote cell " << cells[c] << " does not match its velocity blocks" << std::endl;
+         abort();
+      }
+   }
+   
+   const vector<CellID> sentCells = mpiGrid.get_local_cells_on_process_boundary(neighborhood);
+   #pragma omp parallel for
+   for (size_t c=0; c<sentCells.size(); ++c) {
+      mpiGrid[sentCells[c]]->release_compressed_block_data();
+   }
+}
+
+/** Transfer the stencil data, map the distribution function along one dimension and
+    send the contributions mapped to remote cells to their owners.
+    
+    With P::pipelinedTranslation the transfer is only started, the cells that need no
+    remote data are mapped, and the rest are mapped once the transfer has completed.
+    With AMR the inner pencils are mapped in three parts, the second and third while the
+    mapping contributions of the two directions are in transfer. All sets of a dimension
+    use the block lists built by the first one.
+    With P::compressedTranslationTransfers the block data is packed before and unpacked
+    after the transfer, and the packed lengths are transferred first.
+    
+    \param dimension 0,1,2 for x,y,z
+    \param neighborhood Neighborhood of the translation stencil along dimension
+    \param dimensionName Suffix of the timer names
+    \param time Time spent in the mapping, incremented
+ */
+void transferAndMapDimension(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& local_propagated_cells,
+        const vector<CellID>& remoteTargetCells,
+        vector<uint>& nPencils,
+        const uint dimension,
+        const int neighborhood,
+        const string& dimensionName,
+        creal dt,
+        const uint popID,
+        Real &time
+) {
+   const bool pipelinedAMR = P::pipelinedTranslation && P::amrMaxSpatialRefLevel > 0;
+   
+   auto mapCells = [&](const uint cellSet) {
+      double t1 = MPI_Wtime();
+      phiprof::start("compute-mapping-" + dimensionName);
+      if(P::amrMaxSpatialRefLevel == 0) {
+         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCells, dimension, dt, popID, cellSet);
+      } else {
+         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCells, nPencils, dimension, dt, popID, cellSet);
+      }
+      phiprof::stop("compute-mapping-" + dimensionName);
+      time += MPI_Wtime() - t1;
+   };
+   
+   int trans_timer=phiprof::initializeTimer("transfer-stencil-data-" + dimensionName,"MPI");
+   phiprof::start(trans_timer);
+   if (P::compressedTranslationTransfers) {
+      phiprof::start("compress-stencil-data");
+      compressStencilData(mpiGrid,neighborhood,popID);
+      phiprof::stop("compress-stencil-data");
+      // The cells sent to a process travel in one message, so the receivers need the
+      // packed length of each cell to place the data
+      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA_COMPRESSED_SIZE);
+      mpiGrid.update_copies_of_remote_neighbors(neighborhood);
+      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA_COMPRESSED);
+   } else {
+      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA);
+   }
+   if (P::pipelinedTranslation) {
+      mpiGrid.start_remote_neighbor_copy_updates(neighborhood);
+   } else {
+      mpiGrid.update_copies_of_remote_neighbors(neighborhood);
+      if (P::compressedTranslationTransfers) {
+         phiprof::start("decompress-stencil-data");
+         decompressStencilData(mpiGrid,neighborhood,popID);
+         phiprof::stop("decompress-stencil-data");
+      }
+   }
+   phiprof::stop(trans_timer);
+   
+   if (P::pipelinedTranslation) {
+      mapCells(pipelinedAMR ? translationset::INNER_1 : translationset::INNER);
+      
+      // Boundary cells read the received data and update the sent data
+      trans_timer=phiprof::initializeTimer("wait-stencil-data-" + dimensionName,"MPI","Wait");
+      phiprof::start(trans_timer);
+      mpiGrid.wait_remote_neighbor_copy_update_receives(neighborhood);
+      mpiGrid.wait_remote_neighbor_copy_update_sends();
+      if (P::compressedTranslationTransfers) {
+         phiprof::start("decompress-stencil-data");
+         decompressStencilData(mpiGrid,neighborhood,popID);
+         phiprof::stop("decompress-stencil-data");
+      }
+      phiprof::stop(trans_timer);
+      
+      mapCells(translationset::BOUNDARY);
+   } else {
+      mapCells(translationset::ALL);
+   }
+   
+   int update_timer=phiprof::initializeTimer("update_remote-" + dimensionName,"MPI");
+   if (pipelinedAMR) {
+      // The inner pencils touch no cells of the process boundary, so they
+      // can be mapped while the contributions are in transfer
+      RemoteMappingExchange exchange;
+      for (int direction = 1; direction >= -1; direction -= 2) {
+         phiprof::start(update_timer);
+         start_remote_mapping_contribution_amr(mpiGrid, dimension, direction, popID, exchange);
+         phiprof::stop(update_timer);
+         
+         mapCells(direction > 0 ? translationset::INNER_2 : translationset::INNER_3);
+         
+         phiprof::start(update_timer);
+         finish_remote_mapping_contribution_amr(mpiGrid, popID, exchange);
+         phiprof::stop(update_timer);
+      }
+   } else {
+      phiprof::start(update_timer);
+      if(P::amrMaxSpatialRefLevel == 0) {
+         update_remote_mapping_contribution(mpiGrid, dimension,+1,popID);
+         update_remote_mapping_contribution(mpiGrid, dimension,-1,popID);
+      } else {
+         update_remote_mapping_contribution_amr(mpiGrid, dimension,+1,popID);
+         update_remote_mapping_contribution_amr(mpiGrid, dimension,-1,popID);
+      }
+      phiprof::stop(update_timer);
+   }
+}
+
 /** Propagates the distribution function in spatial space. 
     
     Based on SLICE-3D algorithm: Zerroukat, M., and T. Allen. "A
@@ -77,11 +234,8 @@ void calculateSpatialTranslation(
         Real &time
 ) {
 
-    int trans_timer;
     bool localTargetGridGenerated = false;
     
-    double t1;
-    
     int myRank;
     MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
    
@@ -92,43 +246,8 @@ void calculateSpatialTranslation(
  
     // ------------- SLICE - map dist function in Z --------------- //
    if(P::zcells_ini > 1){
-      trans_timer=phiprof::initializeTimer("transfer-stencil-data-z","MPI");
-      phiprof::start(trans_timer);
-      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_Z_NEIGHBORHOOD_ID);
-      phiprof::stop(trans_timer);
-
-//      bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-z","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      t1 = MPI_Wtime();
-      phiprof::start("compute-mapping-z");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsz, 2, dt,popID); // map along z//
-      } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsz, nPencils, 2, dt,popID); // map along z//
-      }
-      phiprof::stop("compute-mapping-z");
-      time += MPI_Wtime() - t1;
-
-//      bt=phiprof::initializeTimer("barrier-trans-pre-update_remote-z","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      trans_timer=phiprof::initializeTimer("update_remote-z","MPI");
-      phiprof::start("update_remote-z");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 2,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 2,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 2,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 2,-1,popID);
-      }
-      phiprof::stop("update_remote-z");
-
+      transferAndMapDimension(mpiGrid, local_propagated_cells, remoteTargetCellsz, nPencils, 2,
+                              VLASOV_SOLVER_Z_NEIGHBORHOOD_ID, "z", dt, popID, time); // map along z//
    }
 
 //   bt=phiprof::initializeTimer("barrier-trans-pre-x","Barriers","MPI");
@@ -139,45 +258,9 @@ void calculateSpatialTranslation(
    // ------------- SLICE - map dist function in X --------------- //
    if(P::xcells_ini > 1){
       
-      trans_timer=phiprof::initializeTimer("transfer-stencil-data-x","MPI");
-      phiprof::start(trans_timer);
-      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA);
-
       mpiGrid.set_send_single_cells(false);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_X_NEIGHBORHOOD_ID);
-      phiprof::stop(trans_timer);
-      
-//      bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-x","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      t1 = MPI_Wtime();
-      phiprof::start("compute-mapping-x");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsx, 0,dt,popID); // map along x//
-      } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsx, nPencils, 0,dt,popID); // map along x//
-      }
-      phiprof::stop("compute-mapping-x");
-      time += MPI_Wtime() - t1;
-
-//      bt=phiprof::initializeTimer("barrier-trans-pre-update_remote-x","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      trans_timer=phiprof::initializeTimer("update_remote-x","MPI");
-      phiprof::start("update_remote-x");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 0,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 0,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 0,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 0,-1,popID);
-      }
-      phiprof::stop("update_remote-x");
-
+      transferAndMapDimension(mpiGrid, local_propagated_cells, remoteTargetCellsx, nPencils, 0,
+                              VLASOV_SOLVER_X_NEIGHBORHOOD_ID, "x", dt, popID, time); // map along x//
    }
 
 //   bt=phiprof::initializeTimer("barrier-trans-pre-y","Barriers","MPI");
@@ -188,45 +271,9 @@ void calculateSpatialTranslation(
    // ------------- SLICE - map dist function in Y --------------- //
    if(P::ycells_ini > 1) {
       
-      trans_timer=phiprof::initializeTimer("transfer-stencil-data-y","MPI");
-      phiprof::start(trans_timer);
-      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA);
-      
       mpiGrid.set_send_single_cells(false);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_Y_NEIGHBORHOOD_ID);
-      phiprof::stop(trans_timer);
-      
-//      bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-y","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      t1 = MPI_Wtime();
-      phiprof::start("compute-mapping-y");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsy, 1,dt,popID); // map along y//
-      } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsy, nPencils, 1,dt,popID); // map along y//      
-      }
-      phiprof::stop("compute-mapping-y");
-      time += MPI_Wtime() - t1;
-      
-//      bt=phiprof::initializeTimer("barrier-trans-pre-update_remote-y","Barriers","MPI");
-//      phiprof::start(bt);
-//      MPI_Barrier(MPI_COMM_WORLD);
-//      phiprof::stop(bt);
-
-      trans_timer=phiprof::initializeTimer("update_remote-y","MPI");
-      phiprof::start("update_remote-y");
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 1,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 1,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 1,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 1,-1,popID);
-      }
-      phiprof::stop("update_remote-y");
-     
+      transferAndMapDimension(mpiGrid, local_propagated_cells, remoteTargetCellsy, nPencils, 1,
+                              VLASOV_SOLVER_Y_NEIGHBORHOOD_ID, "y", dt, popID, time); // map along y//
    }
 
 //   bt=phiprof::initializeTimer("barrier-trans-post-trans","Barriers","MPI");
@@ -322,23 +369,23 @@ void calculateSpatialTranslation(
    }
    
    if (Parameters::prepareForRebalance == true) {
-      if(P::amrMaxSpatialRefLevel == 0) {
-//          const double deltat = (MPI_Wtime() - t1) / local_propagated_cells.size();
-         for (size_t c=0; c<localCells.size(); ++c) {
-//            mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += time / localCells.size();
-            for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-               mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += mpiGrid[localCells[c]]->get_number_of_velocity_blocks(popID);
-            }
+      // The mapping works on whole columns (pencils with AMR) of cells, so the time measured for it
+      // is shared among the translated cells in proportion to their work: the number of blocks,
+      // times the number of pencils going through the cell with AMR.
+      vector<Real> work(local_propagated_cells.size(), 0.0);
+      Real totalWork = 0.0;
+      for (size_t c=0; c<local_propagated_cells.size(); ++c) {
+         for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+            work[c] += mpiGrid[local_propagated_cells[c]]->get_number_of_velocity_blocks(popID);
          }
-      } else {
-//          const double deltat = MPI_Wtime() - t1;
+         if (P::amrMaxSpatialRefLevel != 0) {
+            work[c] *= nPencils[c];
+         }
+         totalWork += work[c];
+      }
+      if (totalWork > 0.0) {
          for (size_t c=0; c<local_propagated_cells.size(); ++c) {
-            Real counter = 0;
-            for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-               counter += mpiGrid[local_propagated_cells[c]]->get_number_of_velocity_blocks(popID);
-            }
-            mpiGrid[local_propagated_cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += nPencils[c] * counter;
-//            mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += time / localCells.size();
+            mpiGrid[local_propagated_cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += time * work[c] / totalWork;
          }
       }
    }